@@ -0,0 +1,323 @@
+#include "csv_parser.h"
+#include "file_type.h"
+#include "row.h"
+#include "row_store.h"
+#include "xlsx_reader.h"
+#include <benchmark/benchmark.h>
+#include <zlib.h>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Micro-benchmarks for the hot kernels. Every case takes the same four
+// arguments describing the generated data:
+//   columns, field width (bytes), quoted fields (%), numeric fields (%)
+// and reports bytes/s plus rows/s.
+
+namespace {
+
+constexpr size_t ROWS = 1024;
+
+struct Shape {
+    size_t columns;
+    size_t width;
+    int quotedPercent;
+    int numericPercent;
+
+    explicit Shape(const benchmark::State& state)
+        : columns(static_cast<size_t>(state.range(0)))
+        , width(static_cast<size_t>(state.range(1)))
+        , quotedPercent(static_cast<int>(state.range(2)))
+        , numericPercent(static_cast<int>(state.range(3))) {
+    }
+};
+
+// Cell values and their CSV encoding for ROWS rows of `shape`
+struct Dataset {
+    std::vector<std::vector<std::string>> cells;
+    std::vector<std::string> lines;
+    size_t bytes = 0;
+};
+
+std::string makeNumber(std::mt19937_64& random, size_t width) {
+    // Four decimals, integer part padded out to the field width
+    std::string digits = std::to_string(random() % 10000);
+    while (digits.size() < 4) digits.insert(digits.begin(), '0');
+    std::string integer = std::to_string(random() % 1000000 + 1);
+    while (integer.size() + 5 < width) integer += static_cast<char>('0' + random() % 10);
+    return integer + "." + digits;
+}
+
+std::string makeText(std::mt19937_64& random, size_t width, bool quoted) {
+    std::string text;
+    for (size_t i = 0; i < width; ++i) {
+        text += static_cast<char>('a' + random() % 26);
+    }
+    if (quoted && width >= 4) {
+        // Something that needs the quotes: a delimiter and an escaped quote
+        text[width / 3] = ',';
+        text[2 * width / 3] = '"';
+    }
+    return text;
+}
+
+std::string encodeField(const std::string& value) {
+    if (value.find_first_of(",\"\n") == std::string::npos) {
+        return value;
+    }
+    std::string field = "\"";
+    for (char c : value) {
+        if (c == '"') field += '"';
+        field += c;
+    }
+    return field + "\"";
+}
+
+Dataset makeDataset(const Shape& shape, uint64_t seed = 42) {
+    std::mt19937_64 random(seed);
+    Dataset data;
+    for (size_t r = 0; r < ROWS; ++r) {
+        std::vector<std::string> row;
+        std::string line;
+        for (size_t c = 0; c < shape.columns; ++c) {
+            bool numeric = static_cast<int>(random() % 100) < shape.numericPercent;
+            bool quoted = static_cast<int>(random() % 100) < shape.quotedPercent;
+            row.push_back(numeric ? makeNumber(random, shape.width) : makeText(random, shape.width, quoted));
+            if (c > 0) line += ',';
+            line += encodeField(row.back());
+        }
+        data.bytes += line.size() + 1;
+        data.cells.push_back(std::move(row));
+        data.lines.push_back(std::move(line));
+    }
+    return data;
+}
+
+void reportThroughput(benchmark::State& state, size_t bytes, size_t rows = ROWS) {
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+    state.counters["rows/s"] = benchmark::Counter(static_cast<double>(rows),
+        benchmark::Counter::kIsIterationInvariantRate);
+}
+
+void shapes(benchmark::internal::Benchmark* bench) {
+    bench->ArgNames({ "cols", "width", "quoted%", "numeric%" })
+        ->ArgsProduct({ { 4, 16 }, { 8, 32 }, { 0, 50 }, { 0, 100 } });
+}
+
+// Stored (uncompressed) workbook with a single sheet of inline cells:
+// numbers as <v>, text as inline strings
+void writeWorkbook(const std::string& filename, const Dataset& data) {
+    std::string sheet = "<?xml version=\"1.0\"?><worksheet><sheetData>";
+    for (size_t r = 0; r < data.cells.size(); ++r) {
+        sheet += "<row r=\"" + std::to_string(r + 1) + "\">";
+        for (const auto& value : data.cells[r]) {
+            bool numeric = value.find_first_not_of("0123456789.") == std::string::npos;
+            if (numeric) {
+                sheet += "<c><v>" + value + "</v></c>";
+            }
+            else {
+                std::string escaped;
+                for (char ch : value) {
+                    if (ch == '"') escaped += "&quot;";
+                    else escaped += ch;
+                }
+                sheet += "<c t=\"inlineStr\"><is><t>" + escaped + "</t></is></c>";
+            }
+        }
+        sheet += "</row>";
+    }
+    sheet += "</sheetData></worksheet>";
+
+    std::vector<std::pair<std::string, std::string>> parts = {
+        { "_rels/.rels",
+          "<Relationships><Relationship Id=\"rId1\" Type=\"officeDocument\" Target=\"xl/workbook.xml\"/></Relationships>" },
+        { "xl/workbook.xml",
+          "<workbook xmlns:r=\"r\"><sheets><sheet name=\"Sheet1\" sheetId=\"1\" r:id=\"rId1\"/></sheets></workbook>" },
+        { "xl/_rels/workbook.xml.rels",
+          "<Relationships><Relationship Id=\"rId1\" Type=\"worksheet\" Target=\"worksheets/sheet1.xml\"/></Relationships>" },
+        { "xl/worksheets/sheet1.xml", sheet },
+    };
+
+    std::string archive;
+    std::string directory;
+    auto put16 = [](std::string& out, uint32_t v) {
+        out += static_cast<char>(v & 0xFF);
+        out += static_cast<char>((v >> 8) & 0xFF);
+    };
+    auto put32 = [&put16](std::string& out, uint32_t v) {
+        put16(out, v & 0xFFFF);
+        put16(out, v >> 16);
+    };
+
+    for (const auto& [name, bytes] : parts) {
+        uint32_t crc = static_cast<uint32_t>(crc32(0, reinterpret_cast<const Bytef*>(bytes.data()), static_cast<uInt>(bytes.size())));
+        uint32_t offset = static_cast<uint32_t>(archive.size());
+        uint32_t size = static_cast<uint32_t>(bytes.size());
+
+        put32(archive, 0x04034b50);
+        for (uint32_t v : { 20u, 0u, 0u, 0u, 0u }) put16(archive, v);
+        put32(archive, crc);
+        put32(archive, size);
+        put32(archive, size);
+        put16(archive, static_cast<uint32_t>(name.size()));
+        put16(archive, 0);
+        archive += name;
+        archive += bytes;
+
+        put32(directory, 0x02014b50);
+        for (uint32_t v : { 20u, 20u, 0u, 0u, 0u, 0u }) put16(directory, v);
+        put32(directory, crc);
+        put32(directory, size);
+        put32(directory, size);
+        put16(directory, static_cast<uint32_t>(name.size()));
+        for (uint32_t v : { 0u, 0u, 0u, 0u }) put16(directory, v);
+        put32(directory, 0);
+        put32(directory, offset);
+        directory += name;
+    }
+
+    uint32_t directoryOffset = static_cast<uint32_t>(archive.size());
+    archive += directory;
+    put32(archive, 0x06054b50);
+    put16(archive, 0);
+    put16(archive, 0);
+    put16(archive, static_cast<uint32_t>(parts.size()));
+    put16(archive, static_cast<uint32_t>(parts.size()));
+    put32(archive, static_cast<uint32_t>(directory.size()));
+    put32(archive, directoryOffset);
+    put16(archive, 0);
+
+    std::ofstream file(filename, std::ios::binary);
+    file << archive;
+}
+
+} // namespace
+
+// ============ CSV PARSING ============
+
+static void BM_ParseCSVLine(benchmark::State& state) {
+    Dataset data = makeDataset(Shape(state));
+    for (auto _ : state) {
+        for (const auto& line : data.lines) {
+            benchmark::DoNotOptimize(CSVParser::parseCSVLine(line));
+        }
+    }
+    reportThroughput(state, data.bytes);
+}
+BENCHMARK(BM_ParseCSVLine)->Apply(shapes);
+
+// ============ ROW HASHING AND EQUALITY ============
+
+static void BM_RowHash(benchmark::State& state) {
+    Dataset data = makeDataset(Shape(state));
+    std::vector<Row> rows(data.cells.size());
+    for (size_t r = 0; r < rows.size(); ++r) {
+        rows[r].columns = data.cells[r];
+    }
+
+    Row::Hash hash;
+    for (auto _ : state) {
+        for (const auto& row : rows) {
+            benchmark::DoNotOptimize(hash(row));
+        }
+    }
+    reportThroughput(state, data.bytes);
+}
+BENCHMARK(BM_RowHash)->Apply(shapes);
+
+static void BM_CompareValues(benchmark::State& state) {
+    // Same values on both sides: every cell is compared in full
+    Dataset data = makeDataset(Shape(state));
+    Dataset copy = makeDataset(Shape(state));
+
+    for (auto _ : state) {
+        for (size_t r = 0; r < data.cells.size(); ++r) {
+            for (size_t c = 0; c < data.cells[r].size(); ++c) {
+                benchmark::DoNotOptimize(Row::compareValues(data.cells[r][c], copy.cells[r][c]));
+            }
+        }
+    }
+    reportThroughput(state, data.bytes);
+}
+BENCHMARK(BM_CompareValues)->Apply(shapes);
+
+// ============ FILE TYPE DETECTION ============
+
+static void BM_FileTypeDetect(benchmark::State& state) {
+    // Only the extension path is exercised; the shape sets the name length
+    Shape shape(state);
+    std::vector<std::string> names;
+    size_t bytes = 0;
+    for (size_t r = 0; r < ROWS; ++r) {
+        names.push_back(std::string(shape.width * shape.columns, 'f') + (r % 2 ? ".csv" : ".XLSX"));
+        bytes += names.back().size();
+    }
+
+    for (auto _ : state) {
+        for (const auto& name : names) {
+            benchmark::DoNotOptimize(FileTypeDetector::detect(name));
+        }
+    }
+    reportThroughput(state, bytes);
+}
+BENCHMARK(BM_FileTypeDetect)->Apply(shapes);
+
+// ============ XLSX CELL CONVERSION ============
+
+static void BM_XLSXReadCells(benchmark::State& state) {
+    Dataset data = makeDataset(Shape(state));
+    std::string filename = (std::filesystem::temp_directory_path() / "file_compare_bench.xlsx").string();
+    writeWorkbook(filename, data);
+
+    XLSXReader reader(filename);
+    for (auto _ : state) {
+        size_t cells = 0;
+        reader.forEachRow([&cells](const std::vector<std::string_view>& row) {
+            cells += row.size();
+        });
+        benchmark::DoNotOptimize(cells);
+    }
+    reportThroughput(state, data.bytes);
+    std::filesystem::remove(filename);
+}
+BENCHMARK(BM_XLSXReadCells)->Apply(shapes);
+
+// ============ SET DIFFERENCE ============
+
+static void BM_SetDifference(benchmark::State& state) {
+    // Two tables sharing half their rows, diffed both ways as the
+    // in-memory engine does
+    Shape shape(state);
+    Dataset data1 = makeDataset(shape, 1);
+    Dataset data2 = makeDataset(shape, 2);
+    for (size_t r = 0; r < ROWS / 2; ++r) {
+        data2.cells[r] = data1.cells[r];
+    }
+
+    RowTable table1;
+    RowTable table2;
+    std::vector<std::string_view> cells;
+    for (const auto* data : { &data1, &data2 }) {
+        RowTable& table = data == &data1 ? table1 : table2;
+        for (const auto& row : data->cells) {
+            cells.assign(row.begin(), row.end());
+            table.insert(cells);
+        }
+    }
+
+    for (auto _ : state) {
+        size_t different = 0;
+        for (RowStore::RowId id : table1) {
+            different += !table2.contains(table1.store(), id);
+        }
+        for (RowStore::RowId id : table2) {
+            different += !table1.contains(table2.store(), id);
+        }
+        benchmark::DoNotOptimize(different);
+    }
+    reportThroughput(state, data1.bytes + data2.bytes, 2 * ROWS);
+}
+BENCHMARK(BM_SetDifference)->Apply(shapes);
@@ -0,0 +1,322 @@
+#include "block_reader.h"
+#include "csv_tokenizer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(HAVE_LIBURING) && !defined(_WIN32)
+#include <liburing.h>
+#define BLOCK_READER_URING 1
+#endif
+
+namespace {
+
+// Page alignment keeps the buffers usable for O_DIRECT-style block reads
+constexpr size_t BUFFER_ALIGNMENT = 4096;
+
+size_t alignUp(size_t bytes) {
+    return (bytes + BUFFER_ALIGNMENT - 1) / BUFFER_ALIGNMENT * BUFFER_ALIGNMENT;
+}
+
+// End of the last complete record in `data`, which starts at a record
+// boundary: one past the last newline preceded by an even number of quotes
+size_t lastRecordEnd(std::string_view data) {
+    size_t quotes = CSVTokenizer::countByte(data, '"');
+    for (size_t i = data.size(); i-- > 0;) {
+        if (data[i] == '"') {
+            --quotes;
+        }
+        else if (data[i] == '\n' && quotes % 2 == 0) {
+            return i + 1;
+        }
+    }
+    return std::string_view::npos;
+}
+
+} // namespace
+
+#ifdef BLOCK_READER_URING
+struct BlockReader::Ring {
+    io_uring ring;
+};
+#else
+struct BlockReader::Ring {};
+#endif
+
+// ============ BLOCK READER ============
+
+BlockReader::BlockReader(const std::string& filename, size_t blockBytes, unsigned queueDepth)
+    : filename_(filename)
+    , blockBytes_(alignUp(std::max<size_t>(blockBytes, 1))) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Could not open file: " + filename);
+    }
+    handle_ = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        throw std::runtime_error("Could not stat file: " + filename);
+    }
+    size_ = static_cast<uint64_t>(fileSize.QuadPart);
+#else
+    fd_ = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) {
+        throw std::runtime_error("Could not open file: " + filename);
+    }
+
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) {
+        ::close(fd_);
+        throw std::runtime_error("Could not stat file: " + filename);
+    }
+    size_ = static_cast<uint64_t>(st.st_size);
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    // Hint only; failure just means less aggressive read-ahead
+    ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#endif
+
+    unsigned depth = 1;
+#ifdef BLOCK_READER_URING
+    // Kernels without io_uring (or with it disabled) fail here; use pread then
+    ring_ = std::make_unique<Ring>();
+    if (::io_uring_queue_init(std::max(queueDepth, 1u), &ring_->ring, 0) < 0) {
+        ring_.reset();
+    }
+    else {
+        depth = std::max(queueDepth, 1u);
+    }
+#else
+    (void)queueDepth;
+#endif
+
+    // No more slots than the file has blocks
+    uint64_t blocks = (size_ + blockBytes_ - 1) / blockBytes_;
+    depth = static_cast<unsigned>(std::clamp<uint64_t>(blocks, 1, depth));
+
+    buffers_ = static_cast<char*>(::operator new(blockBytes_ * depth, std::align_val_t(BUFFER_ALIGNMENT)));
+    slots_.resize(depth);
+    for (unsigned i = 0; i < depth; ++i) {
+        slots_[i].buffer = buffers_ + i * blockBytes_;
+    }
+
+    try {
+        for (Slot& slot : slots_) {
+            if (nextOffset_ < size_) {
+                submit(slot);
+            }
+        }
+    }
+    catch (...) {
+        release();
+        throw;
+    }
+}
+
+BlockReader::~BlockReader() {
+    release();
+}
+
+void BlockReader::release() {
+#ifdef BLOCK_READER_URING
+    if (ring_) {
+        // The kernel may still write into the buffers; wait for every read
+        for (Slot& slot : slots_) {
+            while (slot.inFlight && !slot.done) {
+                io_uring_cqe* cqe = nullptr;
+                if (::io_uring_wait_cqe(&ring_->ring, &cqe) < 0) {
+                    break;
+                }
+                static_cast<Slot*>(::io_uring_cqe_get_data(cqe))->done = true;
+                ::io_uring_cqe_seen(&ring_->ring, cqe);
+            }
+        }
+        ::io_uring_queue_exit(&ring_->ring);
+        ring_.reset();
+    }
+#endif
+
+    if (buffers_) {
+        ::operator delete(buffers_, std::align_val_t(BUFFER_ALIGNMENT));
+        buffers_ = nullptr;
+    }
+
+#ifdef _WIN32
+    if (handle_) {
+        CloseHandle(static_cast<HANDLE>(handle_));
+        handle_ = nullptr;
+    }
+#else
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+#endif
+}
+
+const char* BlockReader::backend() const {
+    return ring_ ? "io_uring" : "pread";
+}
+
+std::string_view BlockReader::next() {
+    // The caller is done with the previous block; reuse its buffer for the
+    // next unrequested one so the queue stays full
+    if (returned_) {
+        Slot& slot = *returned_;
+        returned_ = nullptr;
+        slot.inFlight = false;
+        if (nextOffset_ < size_) {
+            submit(slot);
+        }
+    }
+
+    // Slots are submitted round-robin, so the oldest read is the next block
+    Slot& slot = slots_[deliver_];
+    if (!slot.inFlight) {
+        return {};
+    }
+    while (!slot.done) {
+        reap();
+    }
+
+    if (slot.result < 0) {
+        throw std::runtime_error("Could not read file: " + filename_ + " (" + std::strerror(-slot.result) + ")");
+    }
+
+    // Short reads are finished synchronously
+    size_t length = static_cast<size_t>(slot.result);
+    while (length < slot.length) {
+        size_t n = readAt(slot.buffer + length, slot.length - length, slot.offset + length);
+        if (n == 0) {
+            // File shrank since it was opened; end at the new size
+            size_ = slot.offset + length;
+            nextOffset_ = std::min(nextOffset_, size_);
+            break;
+        }
+        length += n;
+    }
+
+    deliver_ = (deliver_ + 1) % slots_.size();
+    returned_ = &slot;
+    return std::string_view(slot.buffer, length);
+}
+
+void BlockReader::submit(Slot& slot) {
+    slot.offset = nextOffset_;
+    slot.length = static_cast<size_t>(std::min<uint64_t>(blockBytes_, size_ - nextOffset_));
+    slot.inFlight = true;
+    slot.done = false;
+    nextOffset_ += slot.length;
+
+#ifdef BLOCK_READER_URING
+    if (ring_) {
+        io_uring_sqe* sqe = ::io_uring_get_sqe(&ring_->ring);
+        if (sqe == nullptr) {
+            throw std::runtime_error("io_uring submission queue full: " + filename_);
+        }
+        ::io_uring_prep_read(sqe, fd_, slot.buffer, static_cast<unsigned>(slot.length), slot.offset);
+        ::io_uring_sqe_set_data(sqe, &slot);
+
+        int submitted = ::io_uring_submit(&ring_->ring);
+        if (submitted < 0) {
+            slot.inFlight = false;
+            throw std::runtime_error("io_uring submit failed: " + filename_ + " (" + std::strerror(-submitted) + ")");
+        }
+        return;
+    }
+#endif
+
+    slot.result = static_cast<int>(readAt(slot.buffer, slot.length, slot.offset));
+    slot.done = true;
+}
+
+void BlockReader::reap() {
+#ifdef BLOCK_READER_URING
+    io_uring_cqe* cqe = nullptr;
+    int rc = ::io_uring_wait_cqe(&ring_->ring, &cqe);
+    if (rc < 0) {
+        throw std::runtime_error("io_uring wait failed: " + filename_ + " (" + std::strerror(-rc) + ")");
+    }
+    Slot* slot = static_cast<Slot*>(::io_uring_cqe_get_data(cqe));
+    slot->result = cqe->res;
+    slot->done = true;
+    ::io_uring_cqe_seen(&ring_->ring, cqe);
+#endif
+}
+
+size_t BlockReader::readAt(char* buffer, size_t length, uint64_t offset) {
+#ifdef _WIN32
+    OVERLAPPED overlapped{};
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+    DWORD read = 0;
+    if (!ReadFile(static_cast<HANDLE>(handle_), buffer, static_cast<DWORD>(length), &read, &overlapped)) {
+        if (GetLastError() == ERROR_HANDLE_EOF) {
+            return 0;
+        }
+        throw std::runtime_error("Could not read file: " + filename_);
+    }
+    return read;
+#else
+    while (true) {
+        ssize_t n = ::pread(fd_, buffer, length, static_cast<off_t>(offset));
+        if (n >= 0) {
+            return static_cast<size_t>(n);
+        }
+        if (errno != EINTR) {
+            throw std::runtime_error("Could not read file: " + filename_ + " (" + std::strerror(errno) + ")");
+        }
+    }
+#endif
+}
+
+// ============ CSV CHUNK READER ============
+
+CSVChunkReader::CSVChunkReader(const std::string& filename, size_t blockBytes, unsigned queueDepth)
+    : blocks_(filename, blockBytes, queueDepth) {
+}
+
+bool CSVChunkReader::next(std::string& chunk) {
+    while (true) {
+        std::string_view block = blocks_.next();
+        if (block.empty()) {
+            // Last record without a trailing newline
+            chunk.swap(carry_);
+            carry_.clear();
+            return !chunk.empty();
+        }
+
+        chunk.clear();
+        chunk.reserve(carry_.size() + block.size());
+        chunk.append(carry_).append(block);
+
+        size_t cut = lastRecordEnd(chunk);
+        if (cut == std::string_view::npos) {
+            // Record longer than a block; keep collecting
+            carry_.swap(chunk);
+            continue;
+        }
+
+        carry_.assign(chunk, cut, std::string::npos);
+        chunk.resize(cut);
+        return true;
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Sequential reader that hands out a file as large aligned blocks.
+// With io_uring (HAVE_LIBURING) up to `queueDepth` block reads are kept in
+// flight so the device queue stays busy while the caller works on the last
+// block; without it, or when the ring cannot be set up at run time, blocks
+// are read synchronously with pread (ReadFile on Windows). No threads are
+// started either way.
+class BlockReader {
+public:
+    static constexpr size_t DEFAULT_BLOCK_BYTES = 1 << 20;
+    static constexpr unsigned DEFAULT_QUEUE_DEPTH = 8;
+
+    explicit BlockReader(const std::string& filename,
+        size_t blockBytes = DEFAULT_BLOCK_BYTES,
+        unsigned queueDepth = DEFAULT_QUEUE_DEPTH);
+    ~BlockReader();
+
+    BlockReader(const BlockReader&) = delete;
+    BlockReader& operator=(const BlockReader&) = delete;
+
+    // Next block in file order, empty at end of file. The view is only
+    // valid until the following call.
+    std::string_view next();
+
+    uint64_t size() const { return size_; }
+
+    // "io_uring" or "pread"
+    const char* backend() const;
+
+private:
+    struct Ring;
+
+    struct Slot {
+        char* buffer = nullptr;
+        uint64_t offset = 0;
+        size_t length = 0;   // bytes requested
+        int result = 0;      // bytes read, or -errno
+        bool inFlight = false;
+        bool done = false;
+    };
+
+    void submit(Slot& slot);
+    void reap();
+    size_t readAt(char* buffer, size_t length, uint64_t offset);
+    void release();
+
+    std::string filename_;
+    size_t blockBytes_;
+    uint64_t size_ = 0;
+    uint64_t nextOffset_ = 0;   // first byte not yet requested
+
+    char* buffers_ = nullptr;   // one allocation, page aligned per slot
+    std::vector<Slot> slots_;
+    size_t deliver_ = 0;        // slot handed out by the next call
+    Slot* returned_ = nullptr;  // slot handed out by the last call
+
+    std::unique_ptr<Ring> ring_;
+
+#ifdef _WIN32
+    void* handle_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+// Record-aligned chunks of a CSV file read through a BlockReader. Every
+// chunk but the last ends just after an unquoted newline, so chunks can be
+// parsed independently; a record cut by a block boundary is carried over
+// into the next chunk.
+class CSVChunkReader {
+public:
+    explicit CSVChunkReader(const std::string& filename,
+        size_t blockBytes = BlockReader::DEFAULT_BLOCK_BYTES,
+        unsigned queueDepth = BlockReader::DEFAULT_QUEUE_DEPTH);
+
+    // Replaces `chunk` with the next whole records; false at end of file
+    bool next(std::string& chunk);
+
+    const char* backend() const { return blocks_.backend(); }
+
+private:
+    BlockReader blocks_;
+    std::string carry_;   // partial record after the last cut
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Fixed-capacity FIFO ring shared by any number of producers and consumers.
+// Full and empty sides block on condition variables instead of polling, so
+// idle threads cost no CPU. close() wakes everyone: pushes fail from then
+// on and pops drain what is left, then fail.
+//
+// Meant for coarse work items (a batch of thousands of records), where one
+// uncontended lock per item is noise.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity)
+        : slots_(capacity == 0 ? 1 : capacity) {
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Blocks while full; false if the queue was closed
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notFull_.wait(lock, [this] { return closed_ || count_ < slots_.size(); });
+        if (closed_) {
+            return false;
+        }
+        slots_[(head_ + count_) % slots_.size()] = std::move(item);
+        ++count_;
+        lock.unlock();
+        notEmpty_.notify_one();
+        return true;
+    }
+
+    // Blocks while empty; false once closed and drained
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notEmpty_.wait(lock, [this] { return closed_ || count_ > 0; });
+        if (count_ == 0) {
+            return false;
+        }
+        item = std::move(slots_[head_]);
+        head_ = (head_ + 1) % slots_.size();
+        --count_;
+        lock.unlock();
+        notFull_.notify_one();
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        notEmpty_.notify_all();
+        notFull_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+    std::vector<T> slots_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+    bool closed_ = false;
+};
@@ -0,0 +1,232 @@
+#include "cell_key.h"
+#include "cell_key_policy.h"
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace {
+
+// ============ DECIMAL SCANNER ============
+
+// Significant digits kept exactly; 10^19 - 1 still fits uint64
+constexpr int MAX_SIGNIFICANT = 19;
+
+constexpr uint64_t POWERS_OF_10[] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+    100000000ull, 1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull,
+    10000000000000ull, 100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+    100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull
+};
+
+// [-+]digits[.digits][(e|E)[-+]digits] as digits * 10^exponent
+struct DecimalScan {
+    uint64_t digits = 0;       // first MAX_SIGNIFICANT significant digits
+    int64_t exponent = 0;
+    int significant = 0;
+    int firstDropped = 0;      // first significant digit past the kept ones
+    bool negative = false;
+};
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+//   OPTIMIZED: SWAR, eight ASCII digits validated and converted with a few
+//   64-bit operations instead of eight multiply-adds
+bool isEightDigits(uint64_t chunk) {
+    return (((chunk + 0x4646464646464646) | (chunk - 0x3030303030303030)) & 0x8080808080808080) == 0;
+}
+
+uint32_t eightDigitsValue(uint64_t chunk) {
+    chunk -= 0x3030303030303030;
+    chunk = (chunk * 10) + (chunk >> 8);
+    chunk = (((chunk & 0x000000FF000000FF) * (100 + (1000000ull << 32))) +
+             (((chunk >> 16) & 0x000000FF000000FF) * (1 + (10000ull << 32)))) >> 32;
+    return static_cast<uint32_t>(chunk);
+}
+
+// Consumes a run of digits; fraction digits lower the exponent, integer
+// digits past the kept ones raise it
+const char* scanDigits(const char* p, const char* end, DecimalScan& scan, bool fraction) {
+    if constexpr (std::endian::native == std::endian::little) {
+        // Eight at a time, sixteen-digit runs taking two steps
+        while (end - p >= 8 && scan.significant + 8 <= MAX_SIGNIFICANT) {
+            uint64_t chunk;
+            std::memcpy(&chunk, p, sizeof(chunk));
+            if (!isEightDigits(chunk)) break;
+            scan.digits = scan.digits * 100000000 + eightDigitsValue(chunk);
+            scan.significant += 8;
+            scan.exponent -= fraction ? 8 : 0;
+            p += 8;
+        }
+    }
+
+    for (; p != end && isDigit(*p); ++p) {
+        if (scan.significant < MAX_SIGNIFICANT) {
+            scan.digits = scan.digits * 10 + static_cast<uint64_t>(*p - '0');
+            ++scan.significant;
+            scan.exponent -= fraction ? 1 : 0;
+        }
+        else {
+            if (scan.significant == MAX_SIGNIFICANT) {
+                scan.firstDropped = *p - '0';
+                ++scan.significant;
+            }
+            scan.exponent += fraction ? 0 : 1;
+        }
+    }
+    return p;
+}
+
+bool scanDecimal(std::string_view text, DecimalScan& scan) {
+    const char* p = text.data();
+    const char* end = p + text.size();
+
+    if (p != end && (*p == '-' || *p == '+')) {
+        scan.negative = *p == '-';
+        ++p;
+    }
+
+    // Leading zeros are not significant
+    const char* integer = p;
+    while (p != end && *p == '0') ++p;
+    p = scanDigits(p, end, scan, false);
+    bool anyDigits = p != integer;
+
+    if (p != end && *p == '.') {
+        const char* fraction = ++p;
+        if (scan.significant == 0) {
+            for (; p != end && *p == '0'; ++p) --scan.exponent;
+        }
+        p = scanDigits(p, end, scan, true);
+        anyDigits = anyDigits || p != fraction;
+    }
+    if (!anyDigits) return false;
+
+    if (p != end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool negative = false;
+        if (p != end && (*p == '-' || *p == '+')) {
+            negative = *p == '-';
+            ++p;
+        }
+        const char* digits = p;
+        int64_t exponent = 0;
+        for (; p != end && isDigit(*p); ++p) {
+            // Far beyond any int64 scale; only has to stay clear of overflow
+            if (exponent < 100000) exponent = exponent * 10 + (*p - '0');
+        }
+        if (p == digits) return false;
+        scan.exponent += negative ? -exponent : exponent;
+    }
+    return p == end;
+}
+
+// Magnitude of the scanned number times 10^places, rounded half away from
+// zero. Only the first digit below the rounding position decides, so the
+// kept digits plus firstDropped are enough. False when it exceeds uint64.
+bool scaledMagnitude(const DecimalScan& scan, int places, uint64_t& magnitude) {
+    if (scan.digits == 0) {
+        magnitude = 0;
+        return true;
+    }
+
+    int64_t shift = scan.exponent + places;
+    if (shift >= 0) {
+        if (shift > MAX_SIGNIFICANT) return false;
+        uint64_t power = POWERS_OF_10[shift];
+        if (scan.digits > std::numeric_limits<uint64_t>::max() / power) return false;
+        magnitude = scan.digits * power;
+
+        // With shift > 0 any dropped digits already put the value past int64
+        if (shift == 0 && scan.firstDropped >= 5) {
+            if (magnitude == std::numeric_limits<uint64_t>::max()) return false;
+            ++magnitude;
+        }
+        return true;
+    }
+
+    if (-shift > MAX_SIGNIFICANT) {
+        // Less than half a unit: the digits stay below 10^19
+        magnitude = 0;
+        return true;
+    }
+    uint64_t power = POWERS_OF_10[-shift];
+    magnitude = scan.digits / power + (scan.digits % power >= power / 2 ? 1 : 0);
+    return true;
+}
+
+template <size_t I>
+constexpr CellKey::Policy policyAt() {
+    using P = ComparePolicyAt<I>;
+    return { &P::make, &P::hash, &P::equalText, static_cast<uint32_t>(I), static_cast<int>(I / POLICY_FLAG_COMBINATIONS) };
+}
+
+template <size_t... I>
+constexpr std::array<CellKey::Policy, sizeof...(I)> makePolicies(std::index_sequence<I...>) {
+    return { policyAt<I>()... };
+}
+
+constexpr auto POLICIES = makePolicies(std::make_index_sequence<POLICY_COUNT>{});
+
+size_t policyIndex(const CellKey::Settings& settings) {
+    return static_cast<size_t>(settings.decimalPlaces) * POLICY_FLAG_COMBINATIONS
+        + (settings.foldCase ? 1 : 0) + (settings.trim ? 2 : 0) + (settings.nullsEqual ? 4 : 0);
+}
+
+} // namespace
+
+const CellKey::Policy& CellKey::policyFor(const Settings& settings) {
+    if (settings.decimalPlaces < 0 || settings.decimalPlaces > MAX_DECIMAL_PLACES) {
+        throw std::runtime_error("Decimal places must be between 0 and " + std::to_string(MAX_DECIMAL_PLACES));
+    }
+    return POLICIES[policyIndex(settings)];
+}
+
+const CellKey::Policy& CellKey::defaults() {
+    return POLICIES[policyIndex(Settings{})];
+}
+
+bool CellText::isNullLike(std::string_view cell) {
+    if (cell.size() > 4) return false;
+    for (std::string_view token : { "", "null", "na", "n/a", "#n/a", "nan" }) {
+        if (equalsIgnoreCase(cell, token)) return true;
+    }
+    return false;
+}
+
+CellKey CellText::number(std::string_view cell, int decimalPlaces) {
+    CellKey key;
+
+    //   OPTIMIZED: Exact decimal scan straight to the scaled integer, no
+    //   double in between, so halves round away from zero at any magnitude
+    DecimalScan scan;
+    if (cell.empty() || !scanDecimal(cell, scan)) return key;
+
+    uint64_t magnitude;
+    if (scaledMagnitude(scan, decimalPlaces, magnitude) &&
+        magnitude <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+        key.kind = CellKey::Kind::Scaled;
+        key.value = scan.negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+        return key;
+    }
+
+    // Beyond int64 once scaled: compare the rounded double instead
+    std::string_view number = cell.front() == '+' ? cell.substr(1) : cell;
+    double d;
+    auto [ptr, ec] = std::from_chars(number.data(), number.data() + number.size(), d);
+    if (ec != std::errc() || ptr != number.data() + number.size() || !std::isfinite(d)) {
+        return key;
+    }
+
+    double scaled = std::round(d * static_cast<double>(POWERS_OF_10[decimalPlaces]));
+    key.kind = CellKey::Kind::Float;
+    std::memcpy(&key.value, &scaled, sizeof(scaled));
+    return key;
+}
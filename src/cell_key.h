@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// Canonical comparison key of one cell, computed once at ingest.
+// Numeric cells become an integer scaled exactly to the policy's decimal
+// places, halves rounded away from zero (or the bits of the rounded double
+// when that overflows int64); null-like
+// cells collapse to one Null key when the policy says so; everything else
+// compares as text. Hashing and equality only ever look at this key and the
+// policy's text rules, so they agree by construction.
+struct CellKey {
+    enum class Kind : uint8_t {
+        String,
+        Scaled,
+        Float,
+        Null
+    };
+
+    // Comparison rules of a run, chosen once up front (see policyFor())
+    struct Settings {
+        int decimalPlaces = 4;    // numbers compare rounded to this many places
+        bool foldCase = false;    // text compares ASCII case-insensitively
+        bool trim = false;        // whitespace around any cell is ignored, quoted or not
+        bool nullsEqual = false;  // "", NULL, NA, N/A, #N/A and NaN are one value
+    };
+
+    static constexpr int MAX_DECIMAL_PLACES = 8;
+
+    // One combination of Settings as functions specialised at compile time,
+    // so the per-cell code has no branches on the settings. A comparison
+    // holds the policy it selected and hands it to everything that makes,
+    // hashes or compares keys; keys made under one policy only compare
+    // under that policy. Loops over every cell of a row use the policy's
+    // ComparePolicy type instead (cell_key_policy.h), so these pointers
+    // serve one-off calls.
+    struct Policy {
+        CellKey (*make)(std::string_view cell);
+
+        // Folds one cell into a running row hash
+        uint64_t (*hash)(uint64_t seed, const CellKey& key, std::string_view cell);
+
+        // Text cells (Kind::String)
+        bool (*equalText)(std::string_view a, std::string_view b);
+
+        uint32_t id;  // stable per combination; persisted alongside fingerprints
+        int decimalPlaces;
+
+        bool equal(const CellKey& a, std::string_view cellA,
+            const CellKey& b, std::string_view cellB) const {
+            if (a.kind != b.kind) return false;
+            if (a.kind == Kind::String) return equalText(cellA, cellB);
+            return a.value == b.value;
+        }
+    };
+
+    Kind kind = Kind::String;
+    int64_t value = 0;  // unused for strings and nulls
+
+    // The policy for `settings`; throws std::runtime_error for decimal
+    // places outside 0..MAX_DECIMAL_PLACES. Policies are immutable and live
+    // for the whole program.
+    static const Policy& policyFor(const Settings& settings);
+
+    // The policy of Settings{}
+    static const Policy& defaults();
+};
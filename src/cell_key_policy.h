@@ -0,0 +1,146 @@
+#pragma once
+
+#include "cell_key.h"
+#include <wyhash.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <utility>
+
+// The comparison policies as types, for loops that walk every cell of a row.
+// CellKey::Policy holds function pointers to the same code, which costs an
+// indirect call per cell; a loop templated on ComparePolicy inlines make,
+// hash and equalText instead. visitPolicy() picks the type behind a Policy,
+// so the choice is made once per run rather than once per cell.
+
+// ASCII text rules shared by every policy
+struct CellText {
+    static constexpr char toLower(char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+    }
+
+    static constexpr bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+    }
+
+    static std::string_view trimmed(std::string_view cell) {
+        size_t begin = 0;
+        size_t end = cell.size();
+        while (begin < end && isSpace(cell[begin])) ++begin;
+        while (end > begin && isSpace(cell[end - 1])) --end;
+        return cell.substr(begin, end - begin);
+    }
+
+    static bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (toLower(a[i]) != toLower(b[i])) return false;
+        }
+        return true;
+    }
+
+    // "", NULL, NA, N/A, #N/A or NaN in any case
+    static bool isNullLike(std::string_view cell);
+
+    // Scaled or Float key of a number rounded to `decimalPlaces`; a String
+    // key when the cell is not a number
+    static CellKey number(std::string_view cell, int decimalPlaces);
+};
+
+// Every comparison rule fixed at compile time: the optional rules compile
+// away when off
+template <int DecimalPlaces, bool FoldCase, bool Trim, bool NullsEqual>
+struct ComparePolicy {
+    static std::string_view prepare(std::string_view cell) {
+        if constexpr (Trim) {
+            return CellText::trimmed(cell);
+        }
+        else {
+            return cell;
+        }
+    }
+
+    static CellKey make(std::string_view cell) {
+        cell = prepare(cell);
+
+        if constexpr (NullsEqual) {
+            if (CellText::isNullLike(cell)) {
+                CellKey key;
+                key.kind = CellKey::Kind::Null;
+                return key;
+            }
+        }
+
+        // Cheap reject: numbers start with a digit, a sign or '.'
+        if (cell.empty()) return CellKey{};
+        char first = cell.front();
+        if ((first < '0' || first > '9') && first != '-' && first != '+' && first != '.') return CellKey{};
+
+        return CellText::number(cell, DecimalPlaces);
+    }
+
+    //   OPTIMIZED: Using wyhash over the canonical key, no string formatting
+    static uint64_t hash(uint64_t seed, const CellKey& key, std::string_view cell) {
+        if (key.kind == CellKey::Kind::String) {
+            cell = prepare(cell);
+            if constexpr (FoldCase) {
+                // Fold through a small stack buffer, one chunk at a time
+                char folded[64];
+                for (size_t offset = 0; offset < cell.size(); offset += sizeof(folded)) {
+                    size_t n = std::min(sizeof(folded), cell.size() - offset);
+                    for (size_t i = 0; i < n; ++i) folded[i] = CellText::toLower(cell[offset + i]);
+                    seed = wyhash(folded, n, seed, _wyp);
+                }
+            }
+            else {
+                seed = wyhash(cell.data(), cell.size(), seed, _wyp);
+            }
+
+            // Mix in a null byte as delimiter to prevent concatenation issues
+            // "ab" + "cd" should hash differently from "abc" + "d"
+            const char delimiter = '\0';
+            return wyhash(&delimiter, 1, seed, _wyp);
+        }
+
+        unsigned char bytes[sizeof(key.value) + 1];
+        std::memcpy(bytes, &key.value, sizeof(key.value));
+        bytes[sizeof(key.value)] = static_cast<unsigned char>(key.kind);
+        return wyhash(bytes, sizeof(bytes), seed, _wyp);
+    }
+
+    static bool equalText(std::string_view a, std::string_view b) {
+        a = prepare(a);
+        b = prepare(b);
+        if constexpr (FoldCase) {
+            return CellText::equalsIgnoreCase(a, b);
+        }
+        else {
+            return a == b;
+        }
+    }
+};
+
+// Policy::id layout: decimal places * 8 + foldCase + trim * 2 + nullsEqual * 4.
+// Ids are persisted alongside fingerprints, so keep the layout stable.
+constexpr size_t POLICY_FLAG_COMBINATIONS = 8;
+constexpr size_t POLICY_COUNT = (CellKey::MAX_DECIMAL_PLACES + 1) * POLICY_FLAG_COMBINATIONS;
+
+template <size_t Id>
+using ComparePolicyAt = ComparePolicy<static_cast<int>(Id / POLICY_FLAG_COMBINATIONS),
+                                      (Id & 1) != 0, (Id & 2) != 0, (Id & 4) != 0>;
+
+// Calls `visitor(P{})` with the ComparePolicy type P `policy` was made from,
+// through one table lookup. Every instantiation must return the same type,
+// typically a pointer to a function templated on P.
+template <typename Visitor>
+decltype(auto) visitPolicy(const CellKey::Policy& policy, Visitor&& visitor) {
+    using Result = decltype(visitor(ComparePolicyAt<0>{}));
+    using Entry = Result (*)(Visitor&);
+    return [&]<size_t... Id>(std::index_sequence<Id...>) -> Result {
+        static constexpr Entry TABLE[] = {
+            [](Visitor& v) -> Result { return v(ComparePolicyAt<Id>{}); }...
+        };
+        return TABLE[policy.id](visitor);
+    }(std::make_index_sequence<POLICY_COUNT>{});
+}
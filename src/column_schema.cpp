@@ -0,0 +1,313 @@
+#include "column_schema.h"
+#include "csv_parser.h"
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <map>
+#include <unordered_set>
+
+namespace {
+
+// Digits a packed number may carry, so any of them fits int64
+constexpr size_t MAX_DIGITS = 18;
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+int64_t powerOf10(int exponent) {
+    int64_t power = 1;
+    for (int i = 0; i < exponent; ++i) power *= 10;
+    return power;
+}
+
+// Exact value of canonical fixed-point text with `scale` fractional digits:
+// optional '-', no leading zeros, no negative zero
+bool parseFixed(std::string_view text, int scale, int64_t& value) {
+    size_t i = 0;
+    bool negative = !text.empty() && text[0] == '-';
+    if (negative) ++i;
+
+    size_t integerBegin = i;
+    while (i < text.size() && isDigit(text[i])) ++i;
+    size_t integerDigits = i - integerBegin;
+    if (integerDigits == 0 || (integerDigits > 1 && text[integerBegin] == '0')) return false;
+
+    if (scale > 0) {
+        if (i >= text.size() || text[i] != '.') return false;
+        size_t fractionBegin = ++i;
+        while (i < text.size() && isDigit(text[i])) ++i;
+        if (i - fractionBegin != static_cast<size_t>(scale)) return false;
+    }
+    if (i != text.size() || integerDigits + scale > MAX_DIGITS) return false;
+
+    int64_t magnitude = 0;
+    for (char c : text) {
+        if (isDigit(c)) magnitude = magnitude * 10 + (c - '0');
+    }
+    if (negative && magnitude == 0) return false;
+
+    value = negative ? -magnitude : magnitude;
+    return true;
+}
+
+// Fractional digits of canonical fixed-point text, or -1
+int fixedScale(std::string_view text) {
+    size_t point = text.find('.');
+    int scale = point == std::string_view::npos ? 0 : static_cast<int>(text.size() - point - 1);
+    int64_t value;
+    return parseFixed(text, scale, value) ? scale : -1;
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date, and back
+int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+void civilFromDays(int64_t z, int64_t& y, unsigned& m, unsigned& d) {
+    z += 719468;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<int64_t>(yoe) + era * 400 + (m <= 2);
+}
+
+// YYYY-MM-DD naming a real calendar day
+bool parseDate(std::string_view text, int64_t& days) {
+    if (text.size() != 10 || text[4] != '-' || text[7] != '-') return false;
+    for (size_t i : { 0, 1, 2, 3, 5, 6, 8, 9 }) {
+        if (!isDigit(text[i])) return false;
+    }
+
+    int64_t y = (text[0] - '0') * 1000 + (text[1] - '0') * 100 + (text[2] - '0') * 10 + (text[3] - '0');
+    unsigned m = static_cast<unsigned>((text[5] - '0') * 10 + (text[6] - '0'));
+    unsigned d = static_cast<unsigned>((text[8] - '0') * 10 + (text[9] - '0'));
+    if (m < 1 || m > 12 || d < 1 || d > 31) return false;
+
+    // Rejects e.g. 2025-02-30, which would normalize to another day
+    days = daysFromCivil(y, m, d);
+    int64_t yy;
+    unsigned mm, dd;
+    civilFromDays(days, yy, mm, dd);
+    return yy == y && mm == m && dd == d;
+}
+
+char* writeDigits(char* out, uint64_t value, int width) {
+    for (int i = width - 1; i >= 0; --i) {
+        out[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+    return out + width;
+}
+
+} // namespace
+
+ColumnSchema ColumnSchema::infer(const std::vector<std::vector<std::string>>& sample, const CellKey::Policy& policy) {
+    ColumnSchema schema;
+    schema.policy_ = &policy;
+
+    std::map<size_t, size_t> widths;
+    for (const auto& record : sample) {
+        ++widths[record.size()];
+    }
+    if (widths.empty()) {
+        return schema;
+    }
+    size_t width = std::max_element(widths.begin(), widths.end(),
+        [](const auto& a, const auto& b) { return a.second < b.second; })->first;
+
+    int places = policy.decimalPlaces;
+
+    struct Tally {
+        size_t nonEmpty = 0;
+        size_t integer = 0;
+        size_t date = 0;
+        size_t number = 0;
+        size_t decimal[CellKey::MAX_DECIMAL_PLACES + 1] = {};
+        std::unordered_set<std::string_view> distinct;
+    };
+    std::vector<Tally> tallies(width);
+
+    for (const auto& record : sample) {
+        if (record.size() != width) continue;
+        for (size_t i = 0; i < width; ++i) {
+            std::string_view cell = record[i];
+            if (cell.empty()) continue;
+
+            Tally& tally = tallies[i];
+            ++tally.nonEmpty;
+            tally.distinct.insert(cell);
+
+            int scale = fixedScale(cell);
+            if (scale == 0) ++tally.integer;
+            else if (scale > 0 && scale <= places) ++tally.decimal[scale];
+
+            int64_t days;
+            if (parseDate(cell, days)) ++tally.date;
+
+            CellKey::Kind kind = policy.make(cell).kind;
+            if (kind == CellKey::Kind::Scaled || kind == CellKey::Kind::Float) ++tally.number;
+        }
+    }
+
+    schema.columns_.resize(width);
+    for (size_t i = 0; i < width; ++i) {
+        const Tally& tally = tallies[i];
+        Column& column = schema.columns_[i];
+        if (tally.nonEmpty == 0) continue;
+
+        size_t needed = std::max<size_t>(1, tally.nonEmpty - tally.nonEmpty / 10);
+        int scale = static_cast<int>(std::max_element(tally.decimal + 1, tally.decimal + places + 1) - tally.decimal);
+
+        if (tally.integer >= needed) {
+            column.type = ColumnType::Integer;
+            column.factor = powerOf10(places);
+        }
+        else if (scale <= places && tally.decimal[scale] >= needed) {
+            column.type = ColumnType::Decimal;
+            column.scale = static_cast<uint8_t>(scale);
+            column.factor = powerOf10(places - scale);
+        }
+        else if (tally.date >= needed) {
+            column.type = ColumnType::Date;
+        }
+        else if (tally.number >= needed) {
+            column.type = ColumnType::Float;
+        }
+        else if (tally.distinct.size() * 4 <= tally.nonEmpty) {
+            column.type = ColumnType::Dictionary;
+            column.dictionary = std::make_shared<StringDictionary>(DICTIONARY_CAPACITY, policy);
+        }
+    }
+
+    schema.finish();
+    return schema;
+}
+
+void ColumnSchema::sampleCSV(std::string_view data, size_t records, std::vector<std::vector<std::string>>& sample) {
+    CSVRecordReader reader(data);
+    std::vector<std::string_view> fields;
+    std::string scratch;
+    for (size_t i = 0; i < records && reader.next(fields, scratch); ++i) {
+        sample.emplace_back(fields.begin(), fields.end());
+    }
+}
+
+void ColumnSchema::finish() {
+    slots_.resize(columns_.size());
+    size_t packed = 0;
+    size_t text = 0;
+    for (size_t i = 0; i < columns_.size(); ++i) {
+        slots_[i] = this->packed(i) ? packed++ : text++;
+    }
+    packedCount_ = packed;
+}
+
+bool ColumnSchema::pack(size_t index, std::string_view cell, const CellKey& key, int64_t& value,
+                        StringDictionary::Cache& cache) const {
+    const Column& column = columns_[index];
+    if (cell.empty()) {
+        value = EMPTY;
+        return true;
+    }
+
+    switch (column.type) {
+    case ColumnType::Integer:
+    case ColumnType::Decimal: {
+        int64_t exact;
+        if (!parseFixed(cell, column.scale, exact) || key.kind != CellKey::Kind::Scaled) return false;
+
+        // The key must be the exact value rescaled, so equal packed values
+        // mean equal keys
+        int64_t limit = std::numeric_limits<int64_t>::max() / column.factor;
+        if (exact > limit || exact < -limit || key.value != exact * column.factor) return false;
+        value = exact;
+        return true;
+    }
+    case ColumnType::Date:
+        return parseDate(cell, value);
+    case ColumnType::Dictionary: {
+        // Numbers and nulls have their own keys; only plain text is coded
+        if (key.kind != CellKey::Kind::String) return false;
+        uint32_t code = cache.encode(*column.dictionary, cell);
+        value = code;
+        return code != StringDictionary::NONE;
+    }
+    default:
+        return false;
+    }
+}
+
+std::string_view ColumnSchema::unpack(size_t index, int64_t value, char* buffer) const {
+    if (value == EMPTY) {
+        return {};
+    }
+
+    const Column& column = columns_[index];
+    if (column.type == ColumnType::Dictionary) {
+        return column.dictionary->decode(static_cast<uint32_t>(value));
+    }
+
+    char* out = buffer;
+
+    if (column.type == ColumnType::Date) {
+        int64_t y;
+        unsigned m, d;
+        civilFromDays(value, y, m, d);
+        out = writeDigits(out, static_cast<uint64_t>(y), 4);
+        *out++ = '-';
+        out = writeDigits(out, m, 2);
+        *out++ = '-';
+        out = writeDigits(out, d, 2);
+        return { buffer, static_cast<size_t>(out - buffer) };
+    }
+
+    uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    if (value < 0) *out++ = '-';
+
+    uint64_t unit = static_cast<uint64_t>(powerOf10(column.scale));
+    out = std::to_chars(out, buffer + MAX_TEXT, magnitude / unit).ptr;
+    if (column.scale > 0) {
+        *out++ = '.';
+        out = writeDigits(out, magnitude % unit, column.scale);
+    }
+    return { buffer, static_cast<size_t>(out - buffer) };
+}
+
+CellKey ColumnSchema::key(size_t index, int64_t value) const {
+    if (value == EMPTY) {
+        return policy_->make({});
+    }
+
+    const Column& column = columns_[index];
+    if (column.type == ColumnType::Date || column.type == ColumnType::Dictionary) {
+        // Dates never read as numbers or nulls, and coded text never does
+        return CellKey{};
+    }
+    return CellKey{ CellKey::Kind::Scaled, value * column.factor };
+}
+
+std::string ColumnSchema::describe() const {
+    std::string text;
+    for (const auto& column : columns_) {
+        if (!text.empty()) text += ',';
+        switch (column.type) {
+        case ColumnType::Integer: text += "int"; break;
+        case ColumnType::Decimal: text += "dec" + std::to_string(column.scale); break;
+        case ColumnType::Float: text += "float"; break;
+        case ColumnType::Date: text += "date"; break;
+        case ColumnType::Dictionary: text += "dict"; break;
+        case ColumnType::String: text += "str"; break;
+        }
+    }
+    return text;
+}
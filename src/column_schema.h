@@ -0,0 +1,102 @@
+#pragma once
+
+#include "cell_key.h"
+#include "string_dictionary.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class ColumnType : uint8_t {
+    Integer,  // -?[0-9]+ without leading zeros
+    Decimal,  // fixed-point with the same number of fractional digits throughout
+    Float,    // any other finite number
+    Date,     // YYYY-MM-DD
+    Dictionary,  // low-cardinality text, coded through a StringDictionary
+    String
+};
+
+// Column types of the inputs of one comparison, inferred from a sample of
+// their records. Integer, Decimal and Date columns are packed: a cell in the
+// column's canonical text form is stored as one int64 (the exact scaled
+// number, or days since 1970-01-01) and its text is rebuilt on demand.
+// Text columns whose sample holds few distinct values are packed as
+// Dictionary codes. Float and String columns keep their text.
+//
+// Packing is lossless by construction: pack() only accepts text that
+// unpack() reproduces byte for byte, for numbers only when the cell's
+// CellKey is the packed value times a fixed factor, and for dictionary text
+// only when it is its class's representative. Equal packed values of one
+// column therefore mean equal cells under the comparison policy the schema
+// was inferred with, and only stores using that policy may pack with it.
+// Dictionaries fill up as inputs are read, so a schema is bound to one
+// comparison.
+class ColumnSchema {
+public:
+    struct Column {
+        ColumnType type = ColumnType::String;
+        uint8_t scale = 0;   // Decimal: digits after the point
+        int64_t factor = 1;  // Integer and Decimal: CellKey value per packed unit
+        std::shared_ptr<StringDictionary> dictionary;  // Dictionary only
+    };
+
+    // Packed form of an empty cell in any packed column
+    static constexpr int64_t EMPTY = INT64_MIN;
+
+    // Upper bound of unpack()'s output for numbers and dates
+    static constexpr size_t MAX_TEXT = 24;
+
+    // Distinct texts a dictionary column takes before further new values
+    // are stored as text
+    static constexpr size_t DICTIONARY_CAPACITY = size_t(1) << 16;
+
+    // The width most sampled records share is the schema's; a type claims
+    // a column when it fits 90% of its non-empty sampled cells.
+    // Remaining text columns with at most one distinct value per four
+    // sampled cells become dictionary columns.
+    static ColumnSchema infer(const std::vector<std::vector<std::string>>& sample,
+                              const CellKey::Policy& policy = CellKey::defaults());
+
+    // Appends up to `records` leading records of CSV `data` to `sample`
+    static void sampleCSV(std::string_view data, size_t records, std::vector<std::vector<std::string>>& sample);
+
+    const CellKey::Policy& policy() const { return *policy_; }
+    size_t width() const { return columns_.size(); }
+    const Column& column(size_t index) const { return columns_[index]; }
+    bool packed(size_t index) const { return columns_[index].type == ColumnType::Integer ||
+                                             columns_[index].type == ColumnType::Decimal ||
+                                             columns_[index].type == ColumnType::Date ||
+                                             columns_[index].type == ColumnType::Dictionary; }
+    size_t packedCount() const { return packedCount_; }
+
+    // Where a column of a conforming row lives: its index among the packed
+    // columns, or among the text columns
+    size_t slot(size_t index) const { return slots_[index]; }
+
+    // Packed value of `cell` (whose key is `key`) in column `index`; false
+    // when the cell is not in the column's canonical form. Dictionary text
+    // is looked up through `cache`, the calling thread's cache for that
+    // column.
+    bool pack(size_t index, std::string_view cell, const CellKey& key, int64_t& value,
+              StringDictionary::Cache& cache) const;
+
+    // Canonical text of a packed value, written to `buffer` (MAX_TEXT bytes)
+    // or, for dictionary codes, viewing into the dictionary
+    std::string_view unpack(size_t index, int64_t value, char* buffer) const;
+
+    // The CellKey of the cell a packed value stands for
+    CellKey key(size_t index, int64_t value) const;
+
+    // e.g. "int,dec2,float,date,dict,str"
+    std::string describe() const;
+
+private:
+    void finish();
+
+    const CellKey::Policy* policy_ = &CellKey::defaults();
+    std::vector<Column> columns_;
+    std::vector<size_t> slots_;
+    size_t packedCount_ = 0;
+};
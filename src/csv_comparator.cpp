@@ -1,25 +1,26 @@
 #include "csv_comparator.h"
 #include "csv_parser.h"
+#include "csv_tokenizer.h"
+#include "mapped_file.h"
 #include <fstream>
 #include <iostream>
 #include <algorithm>
 
-size_t CSVComparator::countRows(const std::string& filename) {
+size_t CSVComparator::readCSV(const std::string& filename, RowTable& rows) {
     ZoneScoped;
-    ZoneName("Count Rows", 10);
+    ZoneName("Read CSV", 8);
 
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        throw std::runtime_error("Could not open file: " + filename);
-    }
+    //   OPTIMIZED: Memory-mapped input, fields are views into the mapping
+    MappedFile file(filename);
+
+    // Pre-size from a sampled newline count so the table never rehashes mid-read
+    rows.reserve(CSVTokenizer::estimateRecords(file.data()), file.size());
 
     size_t count = 0;
-    std::string line;
-    while (std::getline(file, line)) {
-        if (!line.empty()) {
-            ++count;
-        }
-    }
+    CSVParser::forEachRecord(file.data(), [&rows, &count](const std::vector<std::string_view>& fields) {
+        rows.insert(fields);
+        ++count;
+    });
 
 #ifdef TRACY_ENABLE
     TracyPlot("Row Count", static_cast<int64_t>(count));
@@ -28,26 +29,6 @@ size_t CSVComparator::countRows(const std::string& filename) {
     return count;
 }
 
-std::unordered_set<Row, Row::Hash> CSVComparator::readCSV(const std::string& filename) {
-    ZoneScoped;
-    ZoneName("Read CSV", 8);
-
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        throw std::runtime_error("Could not open file: " + filename);
-    }
-
-    std::unordered_set<Row, Row::Hash> rows;
-    std::string line;
-
-    while (std::getline(file, line)) {
-        if (line.empty()) continue;
-        rows.insert(CSVParser::parseCSVRow(line));
-    }
-
-    return rows;
-}
-
 void CSVComparator::writeRowsToCSV(const std::string& filename, const std::vector<Row>& rows) {
     ZoneScoped;
     ZoneName("Write CSV Output", 16);
@@ -92,23 +73,17 @@ CSVComparator::ComparisonResult CSVComparator::compare(
     std::cout << "  File 2: " << file2 << std::endl;
     std::cout << std::endl;
 
-    // Count rows for reporting
-    std::cout << "Counting rows..." << std::endl;
-    size_t count1 = countRows(file1);
-    size_t count2 = countRows(file2);
-    std::cout << "  File 1: " << count1 << " rows" << std::endl;
-    std::cout << "  File 2: " << count2 << " rows" << std::endl;
-    std::cout << std::endl;
-
-    // Read both files
+    // Read both files; row counts come out of the same pass
     std::cout << "Reading files..." << std::endl;
-    std::unordered_set<Row, Row::Hash> rows1;
-    std::unordered_set<Row, Row::Hash> rows2;
+    RowTable rows1;
+    RowTable rows2;
+    size_t count1 = 0;
+    size_t count2 = 0;
 
     {
         ZoneScoped;
         ZoneName("Read File 1", 11);
-        rows1 = readCSV(file1);
+        count1 = readCSV(file1, rows1);
 #ifdef TRACY_ENABLE
         TracyPlot("File 1 Rows", static_cast<int64_t>(rows1.size()));
 #endif
@@ -117,12 +92,16 @@ CSVComparator::ComparisonResult CSVComparator::compare(
     {
         ZoneScoped;
         ZoneName("Read File 2", 11);
-        rows2 = readCSV(file2);
+        count2 = readCSV(file2, rows2);
 #ifdef TRACY_ENABLE
         TracyPlot("File 2 Rows", static_cast<int64_t>(rows2.size()));
 #endif
     }
 
+    std::cout << "  File 1: " << count1 << " rows" << std::endl;
+    std::cout << "  File 2: " << count2 << " rows" << std::endl;
+    std::cout << std::endl;
+
     // Build result
     ComparisonResult result;
     result.file1RowCount = rows1.size();
@@ -134,15 +113,15 @@ CSVComparator::ComparisonResult CSVComparator::compare(
         ZoneScoped;
         ZoneName("Find Differences", 16);
 
-        for (const auto& row : rows1) {
-            if (rows2.find(row) == rows2.end()) {
-                result.onlyInFile1.push_back(row);
+        for (RowStore::RowId id : rows1) {
+            if (!rows2.contains(rows1.store(), id)) {
+                result.onlyInFile1.push_back(rows1.store().materialize(id));
             }
         }
 
-        for (const auto& row : rows2) {
-            if (rows1.find(row) == rows1.end()) {
-                result.onlyInFile2.push_back(row);
+        for (RowStore::RowId id : rows2) {
+            if (!rows1.contains(rows2.store(), id)) {
+                result.onlyInFile2.push_back(rows2.store().materialize(id));
             }
         }
     }
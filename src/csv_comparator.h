@@ -1,8 +1,8 @@
 #pragma once
 
 #include "row.h"
+#include "row_store.h"
 #include <string>
-#include <unordered_set>
 #include <vector>
 
 // Tracy profiler integration
@@ -34,6 +34,6 @@ public:
     void writeRowsToCSV(const std::string& filename, const std::vector<Row>& rows);
 
 private:
-    size_t countRows(const std::string& filename);
-    std::unordered_set<Row, Row::Hash> readCSV(const std::string& filename);
+    // Returns the number of rows ingested, duplicates included
+    size_t readCSV(const std::string& filename, RowTable& rows);
 };
\ No newline at end of file
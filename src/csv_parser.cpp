@@ -1,93 +1,230 @@
 #include "csv_parser.h"
+#include "csv_tokenizer.h"
+#include <algorithm>
 #include <cctype>
+#include <cstring>
 
-//  Helper function for in-place trimming (single pass)
-static inline void trimTrailingWhitespace(std::string& str) {
-    while (!str.empty() && std::isspace(static_cast<unsigned char>(str.back()))) {
-        str.pop_back();
-    }
+static inline bool isSpace(char c) {
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
 }
 
-std::vector<std::string> CSVParser::parseCSVLine(std::string_view line) {
-    std::vector<std::string> result;
-
-    // Pre-allocate vector capacity
-    // Typical CSV has 10 columns, allocate 12 for safety margin
-    result.reserve(12);
+//  Unquoted fields: skip leading and trailing whitespace without copying
+static inline std::string_view trimWhitespace(std::string_view field) {
+    size_t begin = 0;
+    size_t end = field.size();
+    while (begin < end && isSpace(field[begin])) ++begin;
+    while (end > begin && isSpace(field[end - 1])) --end;
+    return field.substr(begin, end - begin);
+}
 
-    std::string current;
+// Slow path for a field containing a quote. Runs the full quote state machine
+// and emits a view into the source when the resulting characters are
+// contiguous there, otherwise a view into `scratch`.
+// Field boundaries come from the structural index, so every comma and
+// newline seen here is inside quotes.
+static void parseQuotedField(std::string_view field,
+    std::vector<std::string_view>& fields, std::string& scratch) {
 
-    // Pre-allocate string capacity
-    // Typical field is ~64 bytes, pre-allocate to avoid reallocations
-    current.reserve(64);
+    const size_t mark = scratch.size();
+    size_t sourceStart = 0;
+    bool contiguous = true;
 
     bool inQuotes = false;
-    bool fieldWasQuoted = false;  //   FIX: Track if this field had quotes
-    bool hasContent = false;  // Track if field has non-whitespace
+    bool fieldWasQuoted = false;
+    bool hasContent = false;
 
-    for (size_t i = 0; i < line.length(); ++i) {
-        char c = line[i];
+    auto append = [&](size_t index) {
+        size_t length = scratch.size() - mark;
+        if (length == 0) {
+            sourceStart = index;
+        }
+        else if (index != sourceStart + length) {
+            contiguous = false;
+        }
+        scratch.push_back(field[index]);
+    };
+
+    for (size_t i = 0; i < field.length(); ++i) {
+        char c = field[i];
 
         if (c == '"') {
-            if (inQuotes && i + 1 < line.length() && line[i + 1] == '"') {
+            if (inQuotes && i + 1 < field.length() && field[i + 1] == '"') {
                 // Escaped quote inside quoted field
-                current.push_back('"');
+                append(i);
                 hasContent = true;
                 ++i;
             }
             else {
-                // Toggle quote state
                 inQuotes = !inQuotes;
                 if (inQuotes) {
-                    //   FIX: Mark that this field is quoted
                     fieldWasQuoted = true;
                 }
             }
         }
-        else if (c == ',' && !inQuotes) {
-            // Field delimiter found
-
-            //   FIX: Only trim if field was NOT quoted
-            // Quoted fields preserve all whitespace
-            if (!fieldWasQuoted) {
-                trimTrailingWhitespace(current);
+        else {
+            // Skip leading whitespace (unless we're inside quotes or field was quoted)
+            if (!hasContent && !fieldWasQuoted && !inQuotes && isSpace(c)) {
+                continue;
             }
+            hasContent = true;
+            append(i);
+        }
+    }
+
+    // The field always contains a quote, so it is never trimmed:
+    // quoted fields preserve all whitespace
+
+    size_t length = scratch.size() - mark;
+    if (contiguous) {
+        fields.push_back(field.substr(sourceStart, length));
+        scratch.resize(mark);
+    }
+    else {
+        fields.emplace_back(scratch.data() + mark, length);
+    }
+}
+
+static inline void emitField(std::string_view field,
+    std::vector<std::string_view>& fields, std::string& scratch) {
+    if (std::memchr(field.data(), '"', field.size()) == nullptr) {
+        // Fast path: unquoted field is a trimmed view of the source
+        fields.push_back(trimWhitespace(field));
+    }
+    else {
+        parseQuotedField(field, fields, scratch);
+    }
+}
+
+// Emits the fields of record data[start, end) given its unquoted comma offsets
+static void emitFields(std::string_view data, size_t start, size_t end,
+    const std::vector<size_t>& commas,
+    std::vector<std::string_view>& fields, std::string& scratch) {
+
+    fields.clear();
+    scratch.clear();
+
+    // Unescaped content never exceeds the record length, so one reservation
+    // keeps every view into scratch stable for the whole record
+    scratch.reserve(end - start);
+
+    size_t fieldStart = start;
+    for (size_t comma : commas) {
+        emitField(data.substr(fieldStart, comma - fieldStart), fields, scratch);
+        fieldStart = comma + 1;
+    }
+    emitField(data.substr(fieldStart, end - fieldStart), fields, scratch);
+}
+
+void CSVParser::parseCSVFields(std::string_view line,
+    std::vector<std::string_view>& fields,
+    std::string& scratch) {
 
-            //   OPTIMIZATION 4: Use move semantics to avoid copy
-            result.emplace_back(std::move(current));
+    static thread_local std::vector<size_t> commas;
+    commas.clear();
 
-            // Prepare for next field
-            current.clear();
+    uint64_t quoteCarry = 0;
+    CSVTokenizer::indexStructurals(line, 0, line.length(), quoteCarry, false, commas);
+    emitFields(line, 0, line.length(), commas, fields, scratch);
+}
+
+// ============ RECORD READER ============
+
+CSVRecordReader::CSVRecordReader(std::string_view data)
+    : data_(data) {
+    structurals_.reserve(BLOCK_BYTES / 8);
+}
 
-            //   OPTIMIZATION 5: Maintain string capacity after clear
-            current.reserve(64);
-            hasContent = false;
-            fieldWasQuoted = false;  //   FIX: Reset for next field
+bool CSVRecordReader::indexNextBlock() {
+    if (indexedEnd_ >= data_.size()) {
+        return false;
+    }
+
+    structurals_.clear();
+    cursor_ = 0;
+
+    size_t end = std::min(data_.size(), indexedEnd_ + BLOCK_BYTES);
+    CSVTokenizer::indexStructurals(data_, indexedEnd_, end, quoteCarry_, true, structurals_);
+    indexedEnd_ = end;
+    return true;
+}
+
+bool CSVRecordReader::next(std::vector<std::string_view>& fields, std::string& scratch) {
+    commas_.clear();
+
+    while (true) {
+        size_t start = recordStart_;
+        size_t end;
+
+        if (cursor_ == structurals_.size()) {
+            if (indexNextBlock()) {
+                continue;
+            }
+            // Last record without a trailing newline
+            end = data_.size();
+            recordStart_ = data_.size();
         }
         else {
-            //   OPTIMIZATION 6: Trim leading whitespace during parsing (ONLY if not quoted)
-            // Skip leading whitespace (unless we're inside quotes or field was quoted)
-            if (!hasContent && !fieldWasQuoted && !inQuotes && std::isspace(static_cast<unsigned char>(c))) {
-                continue;  // Never added to string, no allocation
+            size_t pos = structurals_[cursor_++];
+            if (data_[pos] == ',') {
+                commas_.push_back(pos);
+                continue;
             }
+            end = pos;
+            recordStart_ = pos + 1;
+        }
 
-            hasContent = true;
-            current.push_back(c);
+        // Strip the CR of CRLF endings, as text-mode getline does on Windows
+        if (end > start && data_[end - 1] == '\r') {
+            --end;
+        }
+
+        if (end == start) {
+            // Empty line (it cannot hold a comma), or end of data
+            if (recordStart_ >= data_.size() && cursor_ == structurals_.size() &&
+                indexedEnd_ >= data_.size()) {
+                return false;
+            }
+            continue;
+        }
+
+        emitFields(data_, start, end, commas_, fields, scratch);
+        lastRecordStart_ = start;
+        return true;
+    }
+}
+
+void CSVParser::parseRecordAt(std::string_view data, size_t offset,
+    std::vector<std::string_view>& fields,
+    std::string& scratch) {
+
+    // The record ends at the first newline outside quotes
+    bool quoted = false;
+    size_t end = offset;
+    for (; end < data.size(); ++end) {
+        if (data[end] == '"') {
+            quoted = !quoted;
+        }
+        else if (data[end] == '\n' && !quoted) {
+            break;
         }
     }
 
-    // Handle last field
-    //   FIX: Only trim trailing whitespace if field was NOT quoted
-    if (!fieldWasQuoted) {
-        trimTrailingWhitespace(current);
+    if (end > offset && data[end - 1] == '\r') {
+        --end;
     }
-    result.emplace_back(std::move(current));
 
-    return result;
+    parseCSVFields(data.substr(offset, end - offset), fields, scratch);
+}
+
+std::vector<std::string> CSVParser::parseCSVLine(std::string_view line) {
+    std::vector<std::string_view> fields;
+    std::string scratch;
+    parseCSVFields(line, fields, scratch);
+    return std::vector<std::string>(fields.begin(), fields.end());
 }
 
 Row CSVParser::parseCSVRow(std::string_view line) {
     Row row;
     row.columns = parseCSVLine(line);
     return row;
-}
\ No newline at end of file
+}
@@ -4,9 +4,68 @@
 #include <string>
 #include <string_view>
 #include <vector>
+#include <cstdint>
 
 class CSVParser {
 public:
     static std::vector<std::string> parseCSVLine(std::string_view line);
     static Row parseCSVRow(std::string_view line);
-};
\ No newline at end of file
+
+    // Zero-copy split of one line. Fields are views into `line`; only quoted
+    // fields whose content is not contiguous in the source (e.g. "" escapes)
+    // are unescaped into `scratch`. Views are invalidated by the next call.
+    static void parseCSVFields(std::string_view line,
+        std::vector<std::string_view>& fields,
+        std::string& scratch);
+
+    // Invokes fn(fields) for every non-empty record of `data`.
+    // Field views are only valid for the duration of the call.
+    template <typename Fn>
+    static void forEachRecord(std::string_view data, Fn&& fn);
+
+    // Parses the single record that starts at `offset`, which must be a
+    // record boundary (e.g. CSVRecordReader::recordOffset). Only that
+    // record is scanned, so rows can be re-read by offset.
+    static void parseRecordAt(std::string_view data, size_t offset,
+        std::vector<std::string_view>& fields,
+        std::string& scratch);
+};
+
+// Splits a buffer into records using the structural index from CSVTokenizer.
+// Only unquoted newlines end a record, so quoted fields may span lines.
+class CSVRecordReader {
+public:
+    explicit CSVRecordReader(std::string_view data);
+
+    // Parses the next non-empty record. Fields view into the buffer, or into
+    // `scratch` for unescaped quoted fields. Returns false at end of data.
+    bool next(std::vector<std::string_view>& fields, std::string& scratch);
+
+    // Byte offset of the record returned by the last next()
+    size_t recordOffset() const { return lastRecordStart_; }
+
+private:
+    static constexpr size_t BLOCK_BYTES = 64 * 1024;
+
+    bool indexNextBlock();
+
+    std::string_view data_;
+    std::vector<size_t> structurals_;  // unquoted ',' and '\n' of the current block
+    std::vector<size_t> commas_;       // commas of the record being assembled
+    size_t cursor_ = 0;
+    size_t indexedEnd_ = 0;
+    size_t recordStart_ = 0;
+    size_t lastRecordStart_ = 0;
+    uint64_t quoteCarry_ = 0;
+};
+
+template <typename Fn>
+void CSVParser::forEachRecord(std::string_view data, Fn&& fn) {
+    CSVRecordReader reader(data);
+    std::vector<std::string_view> fields;
+    std::string scratch;
+
+    while (reader.next(fields, scratch)) {
+        fn(fields);
+    }
+}
@@ -0,0 +1,202 @@
+#include "csv_tokenizer.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(__AVX2__)
+#define CSV_TOKENIZER_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CSV_TOKENIZER_SSE2
+#include <emmintrin.h>
+#endif
+
+// MSVC has no __PCLMUL__ macro but AVX2 targets always have PCLMULQDQ
+#if defined(__PCLMUL__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define CSV_TOKENIZER_CLMUL
+#include <wmmintrin.h>
+#endif
+
+namespace {
+
+struct BlockMasks {
+    uint64_t quotes;
+    uint64_t commas;
+    uint64_t newlines;
+};
+
+#if defined(CSV_TOKENIZER_AVX2)
+
+inline uint64_t matchMask(__m256i lo, __m256i hi, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    uint32_t l = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, needle)));
+    uint32_t h = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, needle)));
+    return static_cast<uint64_t>(l) | (static_cast<uint64_t>(h) << 32);
+}
+
+inline BlockMasks classify(const char* p) {
+    const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+    return { matchMask(lo, hi, '"'), matchMask(lo, hi, ','), matchMask(lo, hi, '\n') };
+}
+
+#elif defined(CSV_TOKENIZER_SSE2)
+
+inline uint64_t matchMask(const __m128i (&v)[4], char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i) {
+        uint64_t bits = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v[i], needle)));
+        mask |= bits << (16 * i);
+    }
+    return mask;
+}
+
+inline BlockMasks classify(const char* p) {
+    const __m128i v[4] = {
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 48))
+    };
+    return { matchMask(v, '"'), matchMask(v, ','), matchMask(v, '\n') };
+}
+
+#else
+
+inline BlockMasks classify(const char* p) {
+    BlockMasks masks{ 0, 0, 0 };
+    for (int i = 0; i < 64; ++i) {
+        uint64_t bit = uint64_t(1) << i;
+        if (p[i] == '"') masks.quotes |= bit;
+        else if (p[i] == ',') masks.commas |= bit;
+        else if (p[i] == '\n') masks.newlines |= bit;
+    }
+    return masks;
+}
+
+#endif
+
+// Bit i of the result is the xor of quote bits 0..i, i.e. "inside quotes"
+inline uint64_t prefixXor(uint64_t bits) {
+#if defined(CSV_TOKENIZER_CLMUL)
+    const __m128i all = _mm_set1_epi8(static_cast<char>(0xFF));
+    const __m128i product = _mm_clmulepi64_si128(_mm_set_epi64x(0, static_cast<long long>(bits)), all, 0);
+    return static_cast<uint64_t>(_mm_cvtsi128_si64(product));
+#else
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+#endif
+}
+
+inline void emitBits(uint64_t bits, size_t base, std::vector<size_t>& out) {
+    while (bits != 0) {
+        out.push_back(base + static_cast<size_t>(std::countr_zero(bits)));
+        bits &= bits - 1;
+    }
+}
+
+} // namespace
+
+void CSVTokenizer::indexStructurals(std::string_view data, size_t begin, size_t end,
+    uint64_t& quoteCarry, bool splitLines, std::vector<size_t>& out) {
+
+    size_t pos = begin;
+
+    auto processBlock = [&](const char* block, size_t base, uint64_t validBits) {
+        BlockMasks masks = classify(block);
+        uint64_t inside = prefixXor(masks.quotes & validBits) ^ quoteCarry;
+
+        // Broadcast the last bit: all-ones when the block ends inside quotes
+        quoteCarry = static_cast<uint64_t>(static_cast<int64_t>(inside) >> 63);
+
+        uint64_t structurals = masks.commas | (splitLines ? masks.newlines : 0);
+        emitBits(structurals & ~inside & validBits, base, out);
+    };
+
+    for (; pos + 64 <= end; pos += 64) {
+        processBlock(data.data() + pos, pos, ~uint64_t(0));
+    }
+
+    if (pos < end) {
+        // Tail: pad with bytes that are never structural
+        char block[64] = {};
+        size_t length = end - pos;
+        std::memcpy(block, data.data() + pos, length);
+        processBlock(block, pos, (uint64_t(1) << length) - 1);
+    }
+}
+
+size_t CSVTokenizer::countNewlines(std::string_view data) {
+    return countByte(data, '\n');
+}
+
+size_t CSVTokenizer::countByte(std::string_view data, char c) {
+    const char* p = data.data();
+    const char* end = p + data.size();
+    size_t count = 0;
+
+#if defined(CSV_TOKENIZER_AVX2)
+    const __m256i needle = _mm256_set1_epi8(c);
+    while (end - p >= 32) {
+        // Byte counters overflow after 255 hits, so flush at most every 255 blocks
+        size_t blocks = std::min<size_t>(static_cast<size_t>(end - p) / 32, 255);
+        __m256i counters = _mm256_setzero_si256();
+        for (size_t i = 0; i < blocks; ++i, p += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            counters = _mm256_sub_epi8(counters, _mm256_cmpeq_epi8(v, needle));
+        }
+        __m256i sums = _mm256_sad_epu8(counters, _mm256_setzero_si256());
+        count += static_cast<size_t>(_mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1) +
+            _mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3));
+    }
+#elif defined(CSV_TOKENIZER_SSE2)
+    const __m128i needle = _mm_set1_epi8(c);
+    while (end - p >= 16) {
+        // Byte counters overflow after 255 hits, so flush at most every 255 blocks
+        size_t blocks = std::min<size_t>(static_cast<size_t>(end - p) / 16, 255);
+        __m128i counters = _mm_setzero_si128();
+        for (size_t i = 0; i < blocks; ++i, p += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(v, needle));
+        }
+        __m128i sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+        count += static_cast<size_t>(_mm_cvtsi128_si32(sums)) +
+            static_cast<size_t>(_mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
+    }
+#endif
+
+    for (; p < end; ++p) {
+        if (*p == c) ++count;
+    }
+    return count;
+}
+
+size_t CSVTokenizer::estimateRecords(std::string_view data) {
+    constexpr size_t SAMPLE_BYTES = 4 * 1024 * 1024;
+
+    if (data.size() <= SAMPLE_BYTES) {
+        // Small inputs: the exact line count is as cheap as a sample
+        size_t lines = countNewlines(data);
+        return (!data.empty() && data.back() != '\n') ? lines + 1 : lines;
+    }
+
+    size_t sampled = countNewlines(data.substr(0, SAMPLE_BYTES));
+    double perByte = static_cast<double>(sampled + 1) / SAMPLE_BYTES;
+    return static_cast<size_t>(perByte * static_cast<double>(data.size()));
+}
+
+const char* CSVTokenizer::kernelName() {
+#if defined(CSV_TOKENIZER_AVX2)
+    return "AVX2";
+#elif defined(CSV_TOKENIZER_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
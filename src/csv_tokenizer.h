@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Structural index builder in the style of simdcsv.
+// Each 64-byte block is turned into bitmasks of quotes, commas and newlines;
+// quoted regions are masked out with a prefix-xor of the quote bits
+// (carry-less multiply when available), and the remaining structural
+// characters are emitted as offsets in bulk.
+class CSVTokenizer {
+public:
+    // Appends the absolute offsets of unquoted ',' (and unquoted '\n' when
+    // splitLines is set) found in data[begin, end) to `out`.
+    // `quoteCarry` is all-ones while inside quotes and carries the quote
+    // state from one call to the next; start a buffer with 0.
+    static void indexStructurals(std::string_view data, size_t begin, size_t end,
+        uint64_t& quoteCarry, bool splitLines, std::vector<size_t>& out);
+
+    // Number of '\n' bytes in data
+    static size_t countNewlines(std::string_view data);
+
+    // Number of bytes equal to c in data
+    static size_t countByte(std::string_view data, char c);
+
+    // Record count estimate from the newline density of a leading sample,
+    // used to pre-size tables without a separate counting pass
+    static size_t estimateRecords(std::string_view data);
+
+    // Name of the kernel compiled in (AVX2, SSE2 or scalar)
+    static const char* kernelName();
+};
@@ -0,0 +1,228 @@
+#include "external_sort.h"
+#include <zlib.h>
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <system_error>
+
+namespace {
+
+// Entries moved per zlib call; also the zlib buffer size
+constexpr size_t BATCH_BYTES = 64 * 1024;
+constexpr size_t BATCH_ENTRIES = BATCH_BYTES / sizeof(SortEntry);
+
+// Merges beyond this many runs would mostly run into descriptor limits
+constexpr size_t MAX_FAN_IN = 256;
+
+bool before(const SortEntry& a, const SortEntry& b) {
+    if (a.fingerprint != b.fingerprint) return a.fingerprint < b.fingerprint;
+    return a.locator < b.locator;
+}
+
+} // namespace
+
+// ============ SPILL DIRECTORY ============
+
+SpillDirectory::SpillDirectory(const std::string& parent) {
+    std::filesystem::path base = parent.empty() ? std::filesystem::temp_directory_path()
+                                                : std::filesystem::path(parent);
+
+    std::random_device random;
+    for (int attempt = 0; attempt < 16; ++attempt) {
+        std::filesystem::path candidate = base / ("file_compare_spill_" + std::to_string(random()));
+        std::error_code error;
+        if (std::filesystem::create_directory(candidate, error)) {
+            path_ = candidate.string();
+            return;
+        }
+        if (error) {
+            throw std::runtime_error("Cannot create spill directory in " + base.string() + ": " + error.message());
+        }
+    }
+    throw std::runtime_error("Cannot create spill directory in " + base.string());
+}
+
+SpillDirectory::~SpillDirectory() {
+    std::error_code error;
+    std::filesystem::remove_all(path_, error);
+}
+
+std::string SpillDirectory::newFile() {
+    return (std::filesystem::path(path_) / ("run_" + std::to_string(files_++))).string();
+}
+
+// ============ RUN FILES ============
+
+RunWriter::RunWriter(const std::string& path, bool compress, bool append) {
+    // "T" writes plain bytes; gzread() reads either form back, including
+    // concatenated members
+    const char* mode = compress ? (append ? "ab1" : "wb1") : (append ? "abT" : "wbT");
+    file_ = gzopen(path.c_str(), mode);
+    if (!file_) {
+        throw std::runtime_error("Cannot create spill file: " + path);
+    }
+    gzbuffer(file_, BATCH_BYTES);
+    pending_.reserve(BATCH_ENTRIES);
+}
+
+RunWriter::~RunWriter() {
+    if (file_) {
+        gzclose(file_);
+    }
+}
+
+void RunWriter::write(const SortEntry& entry) {
+    pending_.push_back(entry);
+    if (pending_.size() == BATCH_ENTRIES) {
+        flush();
+    }
+}
+
+void RunWriter::flush() {
+    if (pending_.empty()) {
+        return;
+    }
+    unsigned bytes = static_cast<unsigned>(pending_.size() * sizeof(SortEntry));
+    if (gzwrite(file_, pending_.data(), bytes) != static_cast<int>(bytes)) {
+        throw std::runtime_error("Error writing spill file (disk full?)");
+    }
+    pending_.clear();
+}
+
+void RunWriter::close() {
+    flush();
+    int status = gzclose(file_);
+    file_ = nullptr;
+    if (status != Z_OK) {
+        throw std::runtime_error("Error closing spill file (disk full?)");
+    }
+}
+
+RunReader::RunReader(const std::string& path)
+    : path_(path) {
+    file_ = gzopen(path.c_str(), "rb");
+    if (!file_) {
+        throw std::runtime_error("Cannot open spill file: " + path);
+    }
+    gzbuffer(file_, BATCH_BYTES);
+}
+
+RunReader::~RunReader() {
+    if (file_) {
+        gzclose(file_);
+    }
+}
+
+bool RunReader::next(SortEntry& entry) {
+    if (position_ == batch_.size()) {
+        batch_.resize(BATCH_ENTRIES);
+        int bytes = gzread(file_, batch_.data(), static_cast<unsigned>(BATCH_BYTES - BATCH_BYTES % sizeof(SortEntry)));
+        if (bytes < 0 || static_cast<size_t>(bytes) % sizeof(SortEntry) != 0) {
+            throw std::runtime_error("Corrupt spill file: " + path_);
+        }
+        batch_.resize(static_cast<size_t>(bytes) / sizeof(SortEntry));
+        position_ = 0;
+        if (batch_.empty()) {
+            return false;
+        }
+    }
+    entry = batch_[position_++];
+    return true;
+}
+
+// ============ MERGE ============
+
+bool RunMerger::Later::operator()(const Head& a, const Head& b) const {
+    // priority_queue keeps the greatest on top; invert for the smallest
+    return before(b.entry, a.entry);
+}
+
+RunMerger::RunMerger(const std::vector<std::string>& runs) {
+    readers_.reserve(runs.size());
+    for (size_t run = 0; run < runs.size(); ++run) {
+        readers_.push_back(std::make_unique<RunReader>(runs[run]));
+        SortEntry entry;
+        if (readers_.back()->next(entry)) {
+            heap_.push({ entry, run });
+        }
+    }
+}
+
+bool RunMerger::next(SortEntry& entry) {
+    if (heap_.empty()) {
+        return false;
+    }
+    Head head = heap_.top();
+    heap_.pop();
+    entry = head.entry;
+
+    if (readers_[head.run]->next(head.entry)) {
+        heap_.push(head);
+    }
+    return true;
+}
+
+// ============ SORTER ============
+
+ExternalSorter::ExternalSorter(SpillDirectory& spill, size_t budgetBytes, bool compress, const CellKey::Policy& policy)
+    : spill_(spill)
+    , compress_(compress)
+    , fingerprint_(RowFingerprint::function(policy))
+    , capacity_(std::max<size_t>(budgetBytes / sizeof(SortEntry), BATCH_ENTRIES)) {
+}
+
+void ExternalSorter::reserve(size_t rows) {
+    buffer_.reserve(std::min(rows, capacity_));
+}
+
+void ExternalSorter::add(const std::vector<std::string_view>& cells, uint64_t locator) {
+    if (buffer_.size() == capacity_) {
+        spill();
+    }
+    buffer_.push_back({ fingerprint_(cells), locator });
+}
+
+void ExternalSorter::spill() {
+    std::sort(buffer_.begin(), buffer_.end(), before);
+
+    std::string path = spill_.newFile();
+    RunWriter writer(path, compress_);
+    for (const auto& entry : buffer_) {
+        writer.write(entry);
+    }
+    writer.close();
+
+    runs_.push_back(path);
+    buffer_.clear();
+}
+
+std::vector<std::string> ExternalSorter::finish() {
+    if (!buffer_.empty()) {
+        spill();
+    }
+    buffer_ = std::vector<SortEntry>();
+    return std::move(runs_);
+}
+
+size_t ExternalSorter::fanIn(size_t budgetBytes) {
+    return std::clamp<size_t>(budgetBytes / OPEN_RUN_BYTES, 2, MAX_FAN_IN);
+}
+
+std::string ExternalSorter::mergeRuns(SpillDirectory& spill, const std::vector<std::string>& runs, bool compress) {
+    std::string path = spill.newFile();
+    {
+        RunMerger merger(runs);
+        RunWriter writer(path, compress);
+        SortEntry entry;
+        while (merger.next(entry)) {
+            writer.write(entry);
+        }
+        writer.close();
+    }
+
+    for (const auto& run : runs) {
+        std::filesystem::remove(run);
+    }
+    return path;
+}
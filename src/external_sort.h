@@ -0,0 +1,132 @@
+#pragma once
+
+#include "fingerprint_index.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct gzFile_s;
+
+// Out-of-core sorting of fingerprint entries for inputs larger than memory.
+// Entries are collected up to a memory budget, sorted by (fingerprint,
+// locator) and spilled as runs; runs are merged back as one sorted stream.
+// Runs can be deflated (zlib level 1) to trade CPU for spill-disk traffic.
+
+// Private directory for spill files, removed with everything in it on
+// destruction
+class SpillDirectory {
+public:
+    // Creates a uniquely named directory under `parent` (the system
+    // temporary directory when empty)
+    explicit SpillDirectory(const std::string& parent);
+    ~SpillDirectory();
+
+    SpillDirectory(const SpillDirectory&) = delete;
+    SpillDirectory& operator=(const SpillDirectory&) = delete;
+
+    // Path for a new run file
+    std::string newFile();
+
+private:
+    std::string path_;
+    size_t files_ = 0;
+};
+
+using SortEntry = FingerprintIndex::Entry;
+
+// Sequential writer of one run. With `append`, entries go after those
+// already in the file (a compressed file gains another gzip member).
+class RunWriter {
+public:
+    RunWriter(const std::string& path, bool compress, bool append = false);
+    ~RunWriter();
+
+    RunWriter(const RunWriter&) = delete;
+    RunWriter& operator=(const RunWriter&) = delete;
+
+    void write(const SortEntry& entry);
+
+    // Flushes and closes; errors surface here rather than in the destructor
+    void close();
+
+private:
+    void flush();
+
+    gzFile_s* file_ = nullptr;
+    std::vector<SortEntry> pending_;
+};
+
+// Sequential reader of one run, compressed or not
+class RunReader {
+public:
+    explicit RunReader(const std::string& path);
+    ~RunReader();
+
+    RunReader(const RunReader&) = delete;
+    RunReader& operator=(const RunReader&) = delete;
+
+    bool next(SortEntry& entry);
+
+private:
+    gzFile_s* file_ = nullptr;
+    std::string path_;
+    std::vector<SortEntry> batch_;
+    size_t position_ = 0;
+};
+
+// k-way merge of sorted runs into one sorted stream
+class RunMerger {
+public:
+    explicit RunMerger(const std::vector<std::string>& runs);
+
+    bool next(SortEntry& entry);
+
+private:
+    struct Head {
+        SortEntry entry;
+        size_t run;
+    };
+    struct Later {
+        bool operator()(const Head& a, const Head& b) const;
+    };
+
+    std::vector<std::unique_ptr<RunReader>> readers_;
+    std::priority_queue<Head, std::vector<Head>, Later> heap_;
+};
+
+class ExternalSorter {
+public:
+    // Approximate memory held by one open run while merging (batch plus
+    // zlib buffers and window)
+    static constexpr size_t OPEN_RUN_BYTES = 320 * 1024;
+
+    // Rows are fingerprinted under `policy`
+    ExternalSorter(SpillDirectory& spill, size_t budgetBytes, bool compress, const CellKey::Policy& policy);
+
+    // Sink interface shared with FingerprintIndex
+    void reserve(size_t rows);
+    void add(const std::vector<std::string_view>& cells, uint64_t locator);
+
+    // Spills what is left and returns the sorted runs. The sorter is spent.
+    std::vector<std::string> finish();
+
+    // Runs that can be merged at once within `budgetBytes` (at least 2)
+    static size_t fanIn(size_t budgetBytes);
+
+    // Merges `runs` into a single new run and deletes them
+    static std::string mergeRuns(SpillDirectory& spill, const std::vector<std::string>& runs, bool compress);
+
+private:
+    void spill();
+
+    SpillDirectory& spill_;
+    bool compress_;
+    RowFingerprint::Function fingerprint_;
+    size_t capacity_;
+    std::vector<SortEntry> buffer_;
+    std::vector<std::string> runs_;
+};
@@ -1,30 +1,78 @@
 #include "file_comparator.h"
 #include "csv_parser.h"
+#include "csv_tokenizer.h"
+#include "external_sort.h"
+#include "fingerprint_sidecar.h"
+#include "key_index.h"
+#include "mapped_file.h"
+#include "parallel.h"
+#include "parallel_ingest.h"
+#include "partition_scatter.h"
+#include "xlsx_reader.h"
 #include <fstream>
 #include <iostream>
 #include <algorithm>
-#include <xlnt/xlnt.hpp>
-#include <sstream>
-#include <iomanip>
+#include <bit>
+#include <filesystem>
+#include <iterator>
+#include <optional>
+
+namespace {
+
+uint64_t fileBytes(const std::string& filename) {
+    std::error_code error;
+    uint64_t bytes = std::filesystem::file_size(filename, error);
+    return error ? 0 : bytes;
+}
+
+// Leading records of each CSV input sampled for column types
+constexpr size_t SCHEMA_SAMPLE_RECORDS = 1000;
+
+// Column types shared by both inputs, or null when neither is CSV
+std::shared_ptr<const ColumnSchema> inferSchema(const std::string& file1, const std::string& file2,
+                                                const CellKey::Policy& policy) {
+    std::vector<std::vector<std::string>> sample;
+    for (const auto* file : { &file1, &file2 }) {
+        if (FileTypeDetector::detect(*file) == FileType::CSV) {
+            MappedFile mapping(*file);
+            ColumnSchema::sampleCSV(mapping.data(), SCHEMA_SAMPLE_RECORDS, sample);
+        }
+    }
+    if (sample.empty()) {
+        return nullptr;
+    }
+    return std::make_shared<const ColumnSchema>(ColumnSchema::infer(sample, policy));
+}
+
+} // namespace
 
 // ============ CSV FUNCTIONS (EXISTING) ============
 
-size_t FileComparator::countRowsCSV(const std::string& filename) {
+size_t FileComparator::readCSV(const std::string& filename, RowPartitions& rows) {
     ZoneScoped;
-    ZoneName("Count Rows CSV", 14);
+    ZoneName("Read CSV", 8);
 
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        throw std::runtime_error("Could not open file: " + filename);
+    //   OPTIMIZED: Memory-mapped input, fields are views into the mapping
+    MappedFile file(filename);
+
+    if (rows.count() > 1) {
+        //   OPTIMIZED: Record-aligned byte ranges parsed by one worker each
+        size_t count = ParallelCSVIngest::ingest(file.data(), rows);
+#ifdef TRACY_ENABLE
+        TracyPlot("Row Count CSV", static_cast<int64_t>(count));
+#endif
+        return count;
     }
 
+    // Pre-size from a sampled newline count so the table never rehashes mid-read
+    RowTable& table = rows[0];
+    table.reserve(CSVTokenizer::estimateRecords(file.data()), file.size());
+
     size_t count = 0;
-    std::string line;
-    while (std::getline(file, line)) {
-        if (!line.empty()) {
-            ++count;
-        }
-    }
+    CSVParser::forEachRecord(file.data(), [&table, &count](const std::vector<std::string_view>& fields) {
+        table.insert(fields);
+        ++count;
+    });
 
 #ifdef TRACY_ENABLE
     TracyPlot("Row Count CSV", static_cast<int64_t>(count));
@@ -33,184 +81,660 @@ size_t FileComparator::countRowsCSV(const std::string& filename) {
     return count;
 }
 
-std::unordered_set<Row, Row::Hash> FileComparator::readCSV(const std::string& filename) {
+// ============ XLSX FUNCTIONS (NEW) ============
+
+size_t FileComparator::readXLSX(const std::string& filename, RowPartitions& rows) {
     ZoneScoped;
-    ZoneName("Read CSV", 8);
+    ZoneName("Read XLSX", 10);
 
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        throw std::runtime_error("Could not open file: " + filename);
-    }
+    try {
+        //   OPTIMIZED: Streaming reader, the active sheet is inflated and
+        //   pull-parsed chunk by chunk instead of loading the workbook model
+        XLSXReader reader(filename);
+        rows.reserve(reader.estimateRows(), 0);
 
-    std::unordered_set<Row, Row::Hash> rows;
-    std::string line;
+        size_t count = reader.forEachRow([&rows](const std::vector<std::string_view>& cells) {
+            rows.insert(cells);
+        });
 
-    while (std::getline(file, line)) {
-        if (line.empty()) continue;
-        rows.insert(CSVParser::parseCSVRow(line));
-    }
+#ifdef TRACY_ENABLE
+        TracyPlot("Row Count XLSX", static_cast<int64_t>(count));
+#endif
 
-    return rows;
+        return count;
+    }
+    catch (const std::runtime_error& e) {
+        throw std::runtime_error("Error reading XLSX file: " + std::string(e.what()));
+    }
 }
 
-// ============ XLSX FUNCTIONS (NEW) ============
+// ============ AUTO-DISPATCH FUNCTIONS (NEW) ============
 
-size_t FileComparator::countRowsXLSX(const std::string& filename) {
-    ZoneScoped;
-    ZoneName("Count Rows XLSX", 15);
+size_t FileComparator::readFileAuto(const std::string& filename, RowPartitions& rows) {
+    FileType type = FileTypeDetector::detect(filename);
 
-    try {
-        xlnt::workbook wb;
-        wb.load(filename);
+    switch (type) {
+    case FileType::CSV:
+        return readCSV(filename, rows);
+    case FileType::XLSX:
+        return readXLSX(filename, rows);
+    default:
+        throw std::runtime_error("Unsupported file type: " + filename);
+    }
+}
 
-        if (wb.sheet_count() == 0) {
-            throw std::runtime_error("No sheets found in XLSX file");
-        }
+// ============ FINGERPRINT ENGINE ============
 
-        auto ws = wb.active_sheet();
-        size_t count = 0;
-        for (auto row : ws.rows()) {
+template <typename Sink>
+size_t FileComparator::scanLocatedRows(const std::string& filename, Sink& sink) {
+    size_t count = 0;
+
+    switch (FileTypeDetector::detect(filename)) {
+    case FileType::CSV: {
+        MappedFile file(filename);
+        sink.reserve(CSVTokenizer::estimateRecords(file.data()));
+
+        // Locator: byte offset of the record in the file
+        CSVRecordReader reader(file.data());
+        std::vector<std::string_view> fields;
+        std::string scratch;
+        while (reader.next(fields, scratch)) {
+            sink.add(fields, reader.recordOffset());
             ++count;
         }
+        break;
+    }
 
-#ifdef TRACY_ENABLE
-        TracyPlot("Row Count XLSX", static_cast<int64_t>(count));
-#endif
+    case FileType::XLSX:
+        try {
+            // Locator: ordinal of the row in the sheet
+            XLSXReader reader(filename);
+            sink.reserve(reader.estimateRows());
+            uint64_t ordinal = 0;
+            count = reader.forEachRow([&sink, &ordinal](const std::vector<std::string_view>& cells) {
+                sink.add(cells, ordinal++);
+            });
+        }
+        catch (const std::runtime_error& e) {
+            throw std::runtime_error("Error reading XLSX file: " + std::string(e.what()));
+        }
+        break;
 
-        return count;
+    default:
+        throw std::runtime_error("Unsupported file type: " + filename);
+    }
 
+    return count;
+}
+
+size_t FileComparator::fingerprintFile(const std::string& filename, FingerprintIndex& index) {
+    ZoneScoped;
+    ZoneName("Fingerprint File", 16);
+
+    if (options_.sidecars && options_.incremental && FileTypeDetector::detect(filename) == FileType::CSV) {
+        return fingerprintAppended(filename, index);
     }
-    catch (const xlnt::exception& e) {
-        throw std::runtime_error("Error reading XLSX file: " + std::string(e.what()));
+
+    if (options_.sidecars) {
+        if (auto loaded = FingerprintSidecar::load(filename, *policy_)) {
+            std::cout << "  Using index " << FingerprintSidecar::pathFor(filename) << std::endl;
+            index = std::move(loaded->index);
+            return static_cast<size_t>(loaded->rows);
+        }
+    }
+
+    size_t count = scanLocatedRows(filename, index);
+    index.finalize();
+
+    if (options_.sidecars) {
+        // The comparison does not depend on the sidecar; a read-only
+        // directory only costs the next run a re-parse
+        try {
+            FingerprintSidecar::write(filename, index, count);
+            std::cout << "  Wrote index " << FingerprintSidecar::pathFor(filename) << std::endl;
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Warning: " << e.what() << std::endl;
+        }
     }
+    return count;
 }
 
-std::unordered_set<Row, Row::Hash> FileComparator::readXLSX(const std::string& filename) {
+size_t FileComparator::fingerprintAppended(const std::string& filename, FingerprintIndex& index) {
     ZoneScoped;
-    ZoneName("Read XLSX", 10);
+    ZoneName("Fingerprint Appended Rows", 25);
 
-    std::unordered_set<Row, Row::Hash> rows;
+    std::optional<FingerprintSidecar::Loaded> loaded = FingerprintSidecar::loadPrefix(filename, *policy_);
+    MappedFile file(filename);
+    size_t start = loaded ? static_cast<size_t>(loaded->extent) : 0;
 
-    try {
-        xlnt::workbook wb;
+    if (loaded && start == file.size()) {
+        std::cout << "  Using index " << FingerprintSidecar::pathFor(filename) << " (no new rows)" << std::endl;
+        index = std::move(loaded->index);
+        return static_cast<size_t>(loaded->rows);
+    }
 
-        {
-            ZoneScoped;
-            ZoneName("Load XLSX Workbook", 18);
-            wb.load(filename);
+    //   OPTIMIZED: Only the bytes past the indexed extent are parsed; their
+    //   sorted fingerprints are merged into the mapped index
+    std::string_view appended = file.data().substr(start);
+    FingerprintIndex added(*policy_);
+    added.reserve(CSVTokenizer::estimateRecords(appended));
+
+    size_t count = 0;
+    CSVRecordReader reader(appended);
+    std::vector<std::string_view> fields;
+    std::string scratch;
+    while (reader.next(fields, scratch)) {
+        added.add(fields, start + reader.recordOffset());
+        ++count;
+    }
+    added.finalize();
+
+    uint64_t rows = count;
+    bool extended = loaded.has_value();
+    if (extended) {
+        std::cout << "  Appended " << count << " rows to index " << FingerprintSidecar::pathFor(filename) << std::endl;
+        index = FingerprintIndex::merge(loaded->index, added);
+        rows += loaded->rows;
+        loaded.reset();  // unmap before the sidecar is replaced
+    }
+    else {
+        index = std::move(added);
+    }
+
+    // The next run can only parse on from here if the input ends on a
+    // record boundary: a final newline outside quotes
+    bool boundary = !appended.empty() && appended.back() == '\n' &&
+        CSVTokenizer::countByte(appended, '"') % 2 == 0;
+
+    try {
+        FingerprintSidecar::write(filename, index, rows, boundary ? file.size() : 0, false);
+        if (!extended) {
+            std::cout << "  Wrote index " << FingerprintSidecar::pathFor(filename) << std::endl;
         }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Warning: " << e.what() << std::endl;
+    }
+    return static_cast<size_t>(rows);
+}
+
+std::vector<Row> FileComparator::rereadRows(const std::string& filename, const std::vector<uint64_t>& locators) {
+    ZoneScoped;
+    ZoneName("Re-read Differing Rows", 22);
+    RunStats::Scope stage(stats_, "reread_rows");
+    stage.addRows(locators.size());
 
-        if (wb.sheet_count() == 0) {
-            throw std::runtime_error("No sheets found in XLSX file");
+    std::vector<Row> rows;
+    if (locators.empty()) {
+        return rows;
+    }
+    rows.reserve(locators.size());
+
+    auto toRow = [](const std::vector<std::string_view>& cells) {
+        Row row;
+        row.columns.assign(cells.begin(), cells.end());
+        return row;
+    };
+
+    if (FileTypeDetector::detect(filename) == FileType::CSV) {
+        // Jump straight to each record
+        MappedFile file(filename);
+        std::vector<std::string_view> fields;
+        std::string scratch;
+        for (uint64_t offset : locators) {
+            CSVParser::parseRecordAt(file.data(), static_cast<size_t>(offset), fields, scratch);
+            rows.push_back(toRow(fields));
         }
+    }
+    else {
+        // Worksheets cannot be entered mid-stream; replay and pick by ordinal
+        XLSXReader reader(filename);
+        uint64_t ordinal = 0;
+        size_t next = 0;
+        reader.forEachRow([&](const std::vector<std::string_view>& cells) {
+            // Surplus copies of a row repeat its locator
+            while (next < locators.size() && locators[next] == ordinal) {
+                rows.push_back(toRow(cells));
+                ++next;
+            }
+            ++ordinal;
+        });
+    }
 
-        auto ws = wb.active_sheet();
+    return rows;
+}
 
-        {
-            ZoneScoped;
-            ZoneName("Parse XLSX Rows", 15);
-
-            for (auto xlnt_row : ws.rows()) {
-                Row row;
-
-                for (auto cell : xlnt_row) {
-                    std::string value;
-
-                    if (cell.has_value()) {
-                        switch (cell.data_type()) {
-                        case xlnt::cell::type::number: {
-                            double d = cell.value<double>();
-
-                            // Check if it's actually an integer
-                            if (d == std::floor(d) && std::abs(d) < 1e15) {
-                                // Integer - no decimal point
-                                value = std::to_string(static_cast<long long>(d));
-                            }
-                            else {
-                                // Floating point - preserve precision
-                                std::ostringstream oss;
-                                oss << std::fixed << std::setprecision(10) << d;
-                                value = oss.str();
-
-                                // Remove trailing zeros
-                                value.erase(value.find_last_not_of('0') + 1);
-                                if (value.back() == '.') {
-                                    value.pop_back();
-                                }
-                            }
-                            break;
-                        }
-
-                        case xlnt::cell::type::shared_string:
-                        case xlnt::cell::type::inline_string:
-                            value = cell.value<std::string>();
-                            break;
-
-                        case xlnt::cell::type::boolean:
-                            value = cell.value<bool>() ? "true" : "false";
-                            break;
-
-                        case xlnt::cell::type::date:
-                            // Format date as string
-                            value = cell.to_string();
-                            break;
-
-                        case xlnt::cell::type::formula_string:
-                            // Get calculated value, not formula
-                            value = cell.to_string();
-                            break;
-
-                        default:
-                            value = cell.to_string();
-                            break;
-                        }
-                    }
-                    else {
-                        // Empty cell
-                        value = "";
-                    }
-
-                    row.columns.push_back(value);
-                }
+FileComparator::ComparisonResult FileComparator::compareFingerprints(
+    const std::string& file1,
+    const std::string& file2) {
+
+    std::cout << "Reading files (fingerprints only)..." << std::endl;
+    FingerprintIndex index1(*policy_);
+    FingerprintIndex index2(*policy_);
+    size_t count1 = 0;
+    size_t count2 = 0;
+
+    {
+        ZoneScoped;
+        ZoneName("Read File 1", 11);
+        RunStats::Scope stage(stats_, "read_file1");
+        count1 = fingerprintFile(file1, index1);
+        stage.addBytes(fileBytes(file1));
+        stage.addRows(count1);
+    }
+
+    {
+        ZoneScoped;
+        ZoneName("Read File 2", 11);
+        RunStats::Scope stage(stats_, "read_file2");
+        count2 = fingerprintFile(file2, index2);
+        stage.addBytes(fileBytes(file2));
+        stage.addRows(count2);
+    }
+
+    std::cout << "  File 1: " << count1 << " rows" << std::endl;
+    std::cout << "  File 2: " << count2 << " rows" << std::endl;
+    std::cout << std::endl;
+
+    // Multiset comparisons count every copy, set comparisons distinct rows
+    ComparisonResult result;
+    result.file1RowCount = options_.multiset ? count1 : index1.size();
+    result.file2RowCount = options_.multiset ? count2 : index2.size();
+
+    std::cout << "Finding differences..." << std::endl;
+    std::vector<uint64_t> only1;
+    std::vector<uint64_t> only2;
+    {
+        ZoneScoped;
+        ZoneName("Find Differences", 16);
+        RunStats::Scope stage(stats_, "find_differences");
+        stage.addRows(count1 + count2);
+        only1 = FingerprintIndex::difference(index1, index2, options_.multiset);
+        only2 = FingerprintIndex::difference(index2, index1, options_.multiset);
+    }
+
+    // Release the indexes before materializing
+    index1 = FingerprintIndex(*policy_);
+    index2 = FingerprintIndex(*policy_);
+
+    result.onlyInFile1 = rereadRows(file1, only1);
+    result.onlyInFile2 = rereadRows(file2, only2);
+    result.filesMatch = result.onlyInFile1.empty() && result.onlyInFile2.empty();
+
+#ifdef TRACY_ENABLE
+    TracyPlot("Files Match", result.filesMatch ? 1 : 0);
+    TracyPlot("Differences Found",
+        static_cast<int64_t>(result.onlyInFile1.size() + result.onlyInFile2.size()));
+#endif
+
+    return result;
+}
+
+// ============ EXTERNAL ENGINE ============
+
+FileComparator::ComparisonResult FileComparator::compareExternal(
+    const std::string& file1,
+    const std::string& file2) {
+
+    std::cout << "Reading files (external sort, "
+        << options_.memoryBudget / (1024 * 1024) << " MiB budget)..." << std::endl;
+    SpillDirectory spill(options_.spillDirectory);
+    std::vector<std::string> runs1;
+    std::vector<std::string> runs2;
+    size_t count1 = 0;
+    size_t count2 = 0;
+
+    // One side at a time, so each sort gets the whole budget
+    {
+        ZoneScoped;
+        ZoneName("Read File 1", 11);
+        RunStats::Scope stage(stats_, "read_file1");
+        ExternalSorter sorter(spill, options_.memoryBudget, options_.compressSpills, *policy_);
+        count1 = scanLocatedRows(file1, sorter);
+        stage.addBytes(fileBytes(file1));
+        stage.addRows(count1);
+        runs1 = sorter.finish();
+    }
+
+    {
+        ZoneScoped;
+        ZoneName("Read File 2", 11);
+        RunStats::Scope stage(stats_, "read_file2");
+        ExternalSorter sorter(spill, options_.memoryBudget, options_.compressSpills, *policy_);
+        count2 = scanLocatedRows(file2, sorter);
+        stage.addBytes(fileBytes(file2));
+        stage.addRows(count2);
+        runs2 = sorter.finish();
+    }
+
+    std::cout << "  File 1: " << count1 << " rows in " << runs1.size() << " runs" << std::endl;
+    std::cout << "  File 2: " << count2 << " rows in " << runs2.size() << " runs" << std::endl;
+    std::cout << std::endl;
+
+    std::cout << "Finding differences..." << std::endl;
+    std::vector<uint64_t> only1;
+    std::vector<uint64_t> only2;
+    size_t distinct1 = 0;
+    size_t distinct2 = 0;
+    {
+        ZoneScoped;
+        ZoneName("Merge Runs", 10);
+        RunStats::Scope stage(stats_, "find_differences");
+        stage.addRows(count1 + count2);
+
+        // Pre-merge the larger side until every run can be open at once
+        size_t fanIn = ExternalSorter::fanIn(options_.memoryBudget);
+        while (runs1.size() + runs2.size() > fanIn) {
+            auto& runs = runs1.size() >= runs2.size() ? runs1 : runs2;
+            size_t take = std::min(fanIn, runs.size());
+            std::vector<std::string> group(runs.end() - take, runs.end());
+            runs.erase(runs.end() - take, runs.end());
+            runs.push_back(ExternalSorter::mergeRuns(spill, group, options_.compressSpills));
+        }
 
-                rows.insert(row);
+        RunMerger merger1(runs1);
+        RunMerger merger2(runs2);
+        SortEntry entry1;
+        SortEntry entry2;
+        bool has1 = merger1.next(entry1);
+        bool has2 = merger2.next(entry2);
+
+        // Walk both streams one fingerprint at a time; the first entry of a
+        // group has the lowest locator, i.e. the first occurrence
+        while (has1 || has2) {
+            RowFingerprint fingerprint = !has2 || (has1 && entry1.fingerprint < entry2.fingerprint)
+                ? entry1.fingerprint : entry2.fingerprint;
+
+            uint64_t first1 = 0;
+            uint64_t first2 = 0;
+            uint64_t copies1 = 0;
+            uint64_t copies2 = 0;
+            for (; has1 && entry1.fingerprint == fingerprint; has1 = merger1.next(entry1)) {
+                if (copies1++ == 0) first1 = entry1.locator;
+            }
+            for (; has2 && entry2.fingerprint == fingerprint; has2 = merger2.next(entry2)) {
+                if (copies2++ == 0) first2 = entry2.locator;
+            }
+            distinct1 += copies1 > 0;
+            distinct2 += copies2 > 0;
+
+            if (options_.multiset) {
+                if (copies1 > copies2) only1.insert(only1.end(), copies1 - copies2, first1);
+                if (copies2 > copies1) only2.insert(only2.end(), copies2 - copies1, first2);
+            }
+            else {
+                if (copies2 == 0) only1.push_back(first1);
+                if (copies1 == 0) only2.push_back(first2);
             }
         }
+    }
 
-        return rows;
+    std::sort(only1.begin(), only1.end());
+    std::sort(only2.begin(), only2.end());
+
+    ComparisonResult result;
+    result.file1RowCount = options_.multiset ? count1 : distinct1;
+    result.file2RowCount = options_.multiset ? count2 : distinct2;
+    result.onlyInFile1 = rereadRows(file1, only1);
+    result.onlyInFile2 = rereadRows(file2, only2);
+    result.filesMatch = result.onlyInFile1.empty() && result.onlyInFile2.empty();
+
+#ifdef TRACY_ENABLE
+    TracyPlot("Files Match", result.filesMatch ? 1 : 0);
+    TracyPlot("Differences Found",
+        static_cast<int64_t>(result.onlyInFile1.size() + result.onlyInFile2.size()));
+#endif
+
+    return result;
+}
+
+// ============ PARTITIONED ENGINE ============
+
+FileComparator::ComparisonResult FileComparator::comparePartitioned(
+    const std::string& file1,
+    const std::string& file2) {
 
+    size_t workers = std::max<size_t>(options_.threads, 1);
+    size_t partitions = options_.partitions;
+    if (partitions == 0) {
+        // Input bytes stand in for entry bytes (a row is rarely shorter than
+        // its 24-byte entry). Enough partitions that `workers` of them fit the
+        // budget at once and each table stays around cache size, and a few
+        // per worker for balance.
+        constexpr uint64_t TARGET_PARTITION_BYTES = 4 * 1024 * 1024;
+        uint64_t bytes = std::filesystem::file_size(file1) + std::filesystem::file_size(file2);
+        uint64_t needed = std::max<uint64_t>(bytes * workers / std::max<size_t>(options_.memoryBudget, 1),
+                                             bytes / TARGET_PARTITION_BYTES) + 1;
+        partitions = std::clamp<size_t>(std::bit_ceil(static_cast<size_t>(needed)), workers * 4, 256);
     }
-    catch (const xlnt::exception& e) {
-        throw std::runtime_error("Error reading XLSX file: " + std::string(e.what()));
+
+    std::cout << "Reading files (" << partitions << " hash partitions)..." << std::endl;
+    SpillDirectory spill(options_.spillDirectory);
+
+    // Each side buffers up to half the budget before spilling
+    PartitionScatter scatter1(spill, partitions, options_.memoryBudget / 2, options_.compressSpills, *policy_);
+    PartitionScatter scatter2(spill, partitions, options_.memoryBudget / 2, options_.compressSpills, *policy_);
+    size_t count1 = 0;
+    size_t count2 = 0;
+
+    {
+        ZoneScoped;
+        ZoneName("Read File 1", 11);
+        RunStats::Scope stage(stats_, "read_file1");
+        count1 = scanLocatedRows(file1, scatter1);
+        stage.addBytes(fileBytes(file1));
+        stage.addRows(count1);
     }
-}
 
-// ============ AUTO-DISPATCH FUNCTIONS (NEW) ============
+    {
+        ZoneScoped;
+        ZoneName("Read File 2", 11);
+        RunStats::Scope stage(stats_, "read_file2");
+        count2 = scanLocatedRows(file2, scatter2);
+        stage.addBytes(fileBytes(file2));
+        stage.addRows(count2);
+    }
 
-size_t FileComparator::countRowsAuto(const std::string& filename) {
-    FileType type = FileTypeDetector::detect(filename);
+    std::cout << "  File 1: " << count1 << " rows" << std::endl;
+    std::cout << "  File 2: " << count2 << " rows" << std::endl;
+    std::cout << std::endl;
 
-    switch (type) {
-    case FileType::CSV:
-        return countRowsCSV(filename);
-    case FileType::XLSX:
-        return countRowsXLSX(filename);
-    default:
-        throw std::runtime_error("Unsupported file type: " + filename);
+    std::cout << "Finding differences..." << std::endl;
+    std::vector<std::vector<uint64_t>> only1(partitions);
+    std::vector<std::vector<uint64_t>> only2(partitions);
+    std::vector<size_t> distinct1(partitions, 0);
+    std::vector<size_t> distinct2(partitions, 0);
+    {
+        ZoneScoped;
+        ZoneName("Diff Partitions", 15);
+        RunStats::Scope stage(stats_, "find_differences", std::min(workers, partitions));
+        stage.addRows(count1 + count2);
+
+        // Each worker holds one partition pair at a time
+        runParallel(std::min(workers, partitions), [&](size_t w) {
+            for (size_t p = w; p < partitions; p += workers) {
+                FingerprintIndex index1(*policy_);
+                FingerprintIndex index2(*policy_);
+                scatter1.load(p, index1);
+                scatter2.load(p, index2);
+                index1.finalize();
+                index2.finalize();
+
+                only1[p] = FingerprintIndex::difference(index1, index2, options_.multiset);
+                only2[p] = FingerprintIndex::difference(index2, index1, options_.multiset);
+                distinct1[p] = index1.size();
+                distinct2[p] = index2.size();
+            }
+        });
+    }
+
+    std::vector<uint64_t> locators1;
+    std::vector<uint64_t> locators2;
+    size_t total1 = 0;
+    size_t total2 = 0;
+    for (size_t p = 0; p < partitions; ++p) {
+        locators1.insert(locators1.end(), only1[p].begin(), only1[p].end());
+        locators2.insert(locators2.end(), only2[p].begin(), only2[p].end());
+        total1 += distinct1[p];
+        total2 += distinct2[p];
     }
+    std::sort(locators1.begin(), locators1.end());
+    std::sort(locators2.begin(), locators2.end());
+
+    ComparisonResult result;
+    result.file1RowCount = options_.multiset ? count1 : total1;
+    result.file2RowCount = options_.multiset ? count2 : total2;
+    result.onlyInFile1 = rereadRows(file1, locators1);
+    result.onlyInFile2 = rereadRows(file2, locators2);
+    result.filesMatch = result.onlyInFile1.empty() && result.onlyInFile2.empty();
+
+#ifdef TRACY_ENABLE
+    TracyPlot("Files Match", result.filesMatch ? 1 : 0);
+    TracyPlot("Differences Found",
+        static_cast<int64_t>(result.onlyInFile1.size() + result.onlyInFile2.size()));
+#endif
+
+    return result;
 }
 
-std::unordered_set<Row, Row::Hash> FileComparator::readFileAuto(const std::string& filename) {
-    FileType type = FileTypeDetector::detect(filename);
+// ============ KEY-BASED COMPARISON ============
 
-    switch (type) {
-    case FileType::CSV:
-        return readCSV(filename);
-    case FileType::XLSX:
-        return readXLSX(filename);
-    default:
-        throw std::runtime_error("Unsupported file type: " + filename);
+FileComparator::ComparisonResult FileComparator::compareKeyed(
+    const std::string& file1,
+    const std::string& file2) {
+
+    std::cout << "Reading files (keyed join)..." << std::endl;
+    KeyIndex index(options_.keyColumns, *policy_);
+    size_t count1 = 0;
+    size_t count2 = 0;
+
+    {
+        ZoneScoped;
+        ZoneName("Index File 1", 12);
+        RunStats::Scope stage(stats_, "read_file1");
+        count1 = scanLocatedRows(file1, index);
+        stage.addBytes(fileBytes(file1));
+        stage.addRows(count1);
+    }
+
+    ComparisonResult result;
+    result.header = index.header();
+    result.keyColumns = index.keyColumns();
+
+    // Probe with file 2. Added rows are kept as read; modified rows wait for
+    // their file 1 counterpart, which is re-read afterwards.
+    std::vector<uint8_t> matched(index.size(), 0);
+    std::vector<std::pair<uint64_t, Row>> changed;
+    size_t duplicates2 = 0;
+    {
+        ZoneScoped;
+        ZoneName("Probe File 2", 12);
+        RunStats::Scope stage(stats_, "read_file2");
+
+        struct Probe {
+            KeyIndex& index;
+            std::vector<uint8_t>& matched;
+            std::vector<Row>& added;
+            std::vector<std::pair<uint64_t, Row>>& changed;
+            size_t& duplicates;
+
+            void reserve(size_t) {}
+
+            void add(const std::vector<std::string_view>& cells, uint64_t) {
+                auto toRow = [&cells]() {
+                    Row row;
+                    row.columns.assign(cells.begin(), cells.end());
+                    return row;
+                };
+
+                KeyIndex::Id id = index.find(cells);
+                if (id == KeyIndex::NOT_FOUND) {
+                    added.push_back(toRow());
+                    return;
+                }
+                if (matched[id]) {
+                    ++duplicates;
+                    return;
+                }
+                matched[id] = 1;
+                if (index.payloadOf(cells) != index.payload(id)) {
+                    changed.emplace_back(index.locator(id), toRow());
+                }
+            }
+        };
+
+        Probe probe{ index, matched, result.onlyInFile2, changed, duplicates2 };
+        count2 = scanLocatedRows(file2, probe);
+        stage.addBytes(fileBytes(file2));
+        stage.addRows(count2);
+    }
+
+    std::cout << "  File 1: " << count1 << " rows, " << index.size() << " keys" << std::endl;
+    std::cout << "  File 2: " << count2 << " rows" << std::endl;
+    if (index.duplicates() > 0 || duplicates2 > 0) {
+        std::cout << "  Warning: repeated keys ignored (" << index.duplicates() << " in file 1, "
+            << duplicates2 << " in file 2); the first row per key is compared" << std::endl;
+    }
+    std::cout << std::endl;
+
+    std::cout << "Finding differences..." << std::endl;
+    {
+        ZoneScoped;
+        ZoneName("Find Differences", 16);
+        RunStats::Scope stage(stats_, "find_differences");
+        stage.addRows(count1 + count2);
+
+        // One front-to-back re-read of file 1 for removed and modified rows
+        std::vector<uint64_t> removed;
+        for (KeyIndex::Id id = 0; id < index.size(); ++id) {
+            if (!matched[id]) removed.push_back(index.locator(id));
+        }
+        std::vector<uint64_t> wanted = removed;
+        for (const auto& [locator, row] : changed) {
+            wanted.push_back(locator);
+        }
+        std::sort(wanted.begin(), wanted.end());
+        wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+
+        std::vector<Row> rows1 = rereadRows(file1, wanted);
+        auto rowAt = [&](uint64_t locator) -> Row& {
+            return rows1[std::lower_bound(wanted.begin(), wanted.end(), locator) - wanted.begin()];
+        };
+
+        std::sort(removed.begin(), removed.end());
+        for (uint64_t locator : removed) {
+            result.onlyInFile1.push_back(rowAt(locator));
+        }
+
+        for (auto& [locator, row2] : changed) {
+            ComparisonResult::ModifiedRow modified{ std::move(rowAt(locator)), std::move(row2), {} };
+            const auto& cells1 = modified.file1.columns;
+            const auto& cells2 = modified.file2.columns;
+            for (size_t column = 0; column < std::max(cells1.size(), cells2.size()); ++column) {
+                if (column >= cells1.size() || column >= cells2.size() ||
+                    !Row::compareValues(cells1[column], cells2[column], *policy_)) {
+                    modified.changedColumns.push_back(column);
+                }
+            }
+            result.modified.push_back(std::move(modified));
+        }
     }
+
+    const auto& keys = index.table().index();
+    stats_.addHashTable(keys.size(), keys.capacity(), keys.lookups(), keys.groupProbes());
+
+    result.file1RowCount = count1;
+    result.file2RowCount = count2;
+    result.filesMatch = result.onlyInFile1.empty() && result.onlyInFile2.empty() && result.modified.empty();
+
+#ifdef TRACY_ENABLE
+    TracyPlot("Files Match", result.filesMatch ? 1 : 0);
+    TracyPlot("Differences Found", static_cast<int64_t>(
+        result.onlyInFile1.size() + result.onlyInFile2.size() + result.modified.size()));
+#endif
+
+    return result;
 }
 
 // ============ COMPARISON AND OUTPUT (UPDATED) ============
@@ -218,6 +742,8 @@ std::unordered_set<Row, Row::Hash> FileComparator::readFileAuto(const std::strin
 void FileComparator::writeRowsToCSV(const std::string& filename, const std::vector<Row>& rows) {
     ZoneScoped;
     ZoneName("Write CSV Output", 16);
+    RunStats::Scope stage(stats_, "write_output");
+    stage.addRows(rows.size());
 
     std::ofstream file(filename);
     if (!file.is_open()) {
@@ -245,6 +771,56 @@ void FileComparator::writeRowsToCSV(const std::string& filename, const std::vect
         }
         file << "\n";
     }
+    stage.addBytes(static_cast<uint64_t>(file.tellp()));
+}
+
+RowDigest FileComparator::digestFile(const std::string& filename) {
+    ZoneScoped;
+    ZoneName("Digest File", 11);
+
+    RowDigest digest;
+    RowFingerprint::Function fingerprint = RowFingerprint::function(*policy_);
+
+    switch (FileTypeDetector::detect(filename)) {
+    case FileType::CSV: {
+        //   OPTIMIZED: One pass over the mapping, O(1) state per worker
+        MappedFile file(filename);
+        size_t workers = std::max<size_t>(options_.threads, 1);
+        std::vector<size_t> boundaries = ParallelCSVIngest::chunkBoundaries(file.data(), workers);
+        std::vector<RowDigest> partial(workers);
+
+        runParallel(workers, [&](size_t w) {
+            CSVRecordReader reader(file.data().substr(boundaries[w], boundaries[w + 1] - boundaries[w]));
+            std::vector<std::string_view> fields;
+            std::string scratch;
+            while (reader.next(fields, scratch)) {
+                partial[w].add(fingerprint(fields));
+            }
+        });
+
+        for (const RowDigest& part : partial) {
+            digest.merge(part);
+        }
+        break;
+    }
+
+    case FileType::XLSX:
+        try {
+            XLSXReader reader(filename);
+            reader.forEachRow([fingerprint, &digest](const std::vector<std::string_view>& cells) {
+                digest.add(fingerprint(cells));
+            });
+        }
+        catch (const std::runtime_error& e) {
+            throw std::runtime_error("Error reading XLSX file: " + std::string(e.what()));
+        }
+        break;
+
+    default:
+        throw std::runtime_error("Unsupported file type: " + filename);
+    }
+
+    return digest;
 }
 
 FileComparator::ComparisonResult FileComparator::compare(
@@ -266,23 +842,74 @@ FileComparator::ComparisonResult FileComparator::compare(
     std::cout << "  File 2 type: " << FileTypeDetector::toString(type2) << std::endl;
     std::cout << std::endl;
 
-    // Count rows for reporting
-    std::cout << "Counting rows..." << std::endl;
-    size_t count1 = countRowsAuto(file1);
-    size_t count2 = countRowsAuto(file2);
-    std::cout << "  File 1: " << count1 << " rows" << std::endl;
-    std::cout << "  File 2: " << count2 << " rows" << std::endl;
-    std::cout << std::endl;
+    if (options_.check) {
+        // Equal digests mean equal rows; only a mismatch pays for a full diff
+        std::cout << "Checking digests..." << std::endl;
+        RowDigest digest1;
+        RowDigest digest2;
+        {
+            RunStats::Scope stage(stats_, "digest_file1", options_.threads);
+            digest1 = digestFile(file1);
+            stage.addBytes(fileBytes(file1));
+            stage.addRows(digest1.count);
+        }
+        {
+            RunStats::Scope stage(stats_, "digest_file2", options_.threads);
+            digest2 = digestFile(file2);
+            stage.addBytes(fileBytes(file2));
+            stage.addRows(digest2.count);
+        }
+
+        if (digest1 == digest2) {
+            std::cout << "  Digests match" << std::endl;
+            ComparisonResult result{};
+            result.filesMatch = true;
+            result.matchedByDigest = true;
+            result.file1RowCount = digest1.count;
+            result.file2RowCount = digest2.count;
+            return result;
+        }
+        std::cout << "  Digests differ, running full comparison" << std::endl;
+        std::cout << std::endl;
+    }
+
+    if (!options_.keyColumns.empty()) {
+        return compareKeyed(file1, file2);
+    }
+    if (options_.engine == Engine::Fingerprint) {
+        return compareFingerprints(file1, file2);
+    }
+    if (options_.engine == Engine::External) {
+        return compareExternal(file1, file2);
+    }
+    if (options_.engine == Engine::Partitioned) {
+        return comparePartitioned(file1, file2);
+    }
+
+    // Both inputs share one inferred schema, so their packed rows compare
+    // block against block
+    std::shared_ptr<const ColumnSchema> schema;
+    if (options_.typedColumns) {
+        schema = inferSchema(file1, file2, *policy_);
+        if (schema) {
+            stats_.setField("column_types", schema->describe());
+        }
+    }
 
-    // Read both files
+    // Read both files; row counts come out of the same pass
     std::cout << "Reading files..." << std::endl;
-    std::unordered_set<Row, Row::Hash> rows1;
-    std::unordered_set<Row, Row::Hash> rows2;
+    RowPartitions rows1(options_.threads, *policy_, schema);
+    RowPartitions rows2(options_.threads, *policy_, schema);
+    size_t count1 = 0;
+    size_t count2 = 0;
 
     {
         ZoneScoped;
         ZoneName("Read File 1", 11);
-        rows1 = readFileAuto(file1);
+        RunStats::Scope stage(stats_, "read_file1", options_.threads);
+        count1 = readFileAuto(file1, rows1);
+        stage.addBytes(fileBytes(file1));
+        stage.addRows(count1);
 #ifdef TRACY_ENABLE
         TracyPlot("File 1 Rows", static_cast<int64_t>(rows1.size()));
 #endif
@@ -291,33 +918,83 @@ FileComparator::ComparisonResult FileComparator::compare(
     {
         ZoneScoped;
         ZoneName("Read File 2", 11);
-        rows2 = readFileAuto(file2);
+        RunStats::Scope stage(stats_, "read_file2", options_.threads);
+        count2 = readFileAuto(file2, rows2);
+        stage.addBytes(fileBytes(file2));
+        stage.addRows(count2);
 #ifdef TRACY_ENABLE
         TracyPlot("File 2 Rows", static_cast<int64_t>(rows2.size()));
 #endif
     }
 
-    // Build result
+    std::cout << "  File 1: " << count1 << " rows" << std::endl;
+    std::cout << "  File 2: " << count2 << " rows" << std::endl;
+    std::cout << std::endl;
+
+    if (schema) {
+        uint64_t packed = 0;
+        for (const auto* rows : { &rows1, &rows2 }) {
+            for (size_t p = 0; p < rows->count(); ++p) {
+                packed += (*rows)[p].store().packedRows();
+            }
+        }
+        stats_.setField("packed_rows", packed);
+    }
+
+    // Build result; multiset comparisons count every copy, set comparisons
+    // distinct rows
     ComparisonResult result;
-    result.file1RowCount = rows1.size();
-    result.file2RowCount = rows2.size();
+    result.file1RowCount = options_.multiset ? count1 : rows1.size();
+    result.file2RowCount = options_.multiset ? count2 : rows2.size();
 
     // Find differences
     std::cout << "Finding differences..." << std::endl;
     {
         ZoneScoped;
         ZoneName("Find Differences", 16);
+        RunStats::Scope stage(stats_, "find_differences", rows1.count());
+        stage.addRows(count1 + count2);
+
+        // Equal rows share a partition, so partition pairs diff independently
+        std::vector<std::vector<Row>> only1(rows1.count());
+        std::vector<std::vector<Row>> only2(rows2.count());
+
+        // Rows of `from` missing from `against`; in multiset mode, one
+        // entry per surplus copy
+        auto difference = [this](const RowTable& from, const RowTable& against, std::vector<Row>& out) {
+            for (RowStore::RowId id : from) {
+                RowStore::RowId match = against.find(from.store(), id);
+                uint32_t surplus = 0;
+                if (options_.multiset) {
+                    uint32_t matched = match == RowTable::NOT_FOUND ? 0 : against.count(match);
+                    surplus = from.count(id) > matched ? from.count(id) - matched : 0;
+                }
+                else {
+                    surplus = match == RowTable::NOT_FOUND ? 1 : 0;
+                }
+                if (surplus > 0) {
+                    out.insert(out.end(), surplus, from.store().materialize(id));
+                }
+            }
+        };
+
+        runParallel(rows1.count(), [&](size_t p) {
+            difference(rows1[p], rows2[p], only1[p]);
+            difference(rows2[p], rows1[p], only2[p]);
+        });
 
-        for (const auto& row : rows1) {
-            if (rows2.find(row) == rows2.end()) {
-                result.onlyInFile1.push_back(row);
+        for (const auto* rows : { &rows1, &rows2 }) {
+            for (size_t p = 0; p < rows->count(); ++p) {
+                const auto& index = (*rows)[p].index();
+                stats_.addHashTable(index.size(), index.capacity(), index.lookups(), index.groupProbes());
             }
         }
 
-        for (const auto& row : rows2) {
-            if (rows1.find(row) == rows1.end()) {
-                result.onlyInFile2.push_back(row);
-            }
+        for (auto& rows : only1) {
+            std::move(rows.begin(), rows.end(), std::back_inserter(result.onlyInFile1));
+        }
+        for (auto& rows : only2) {
+            std::move(rows.begin(), rows.end(), std::back_inserter(result.onlyInFile2));
         }
     }
 
@@ -2,8 +2,11 @@
 
 #include "row.h"
 #include "file_type.h"
+#include "row_store.h"
+#include "cell_key.h"
+#include "fingerprint_index.h"
+#include "run_stats.h"
 #include <string>
-#include <unordered_set>
 #include <vector>
 
 // Tracy profiler integration
@@ -20,7 +23,70 @@
 
 class FileComparator {
 public:
-    FileComparator() = default;
+    enum class Engine {
+        InMemory,     // Every distinct row of both files held in row tables
+        Fingerprint,  // 24 bytes per row; differing rows are re-read from disk
+        External,     // Fingerprints sorted in spilled runs within a memory budget
+        Partitioned   // Fingerprints scattered into hash partitions, diffed per partition
+    };
+
+    struct Options {
+        Engine engine = Engine::InMemory;
+
+        // Workers for CSV ingest and the diff of the in-memory engine; rows
+        // are hash-partitioned into one table per worker
+        size_t threads = 1;
+
+        // Compare as multisets: a row repeated more often in one file than
+        // the other is reported once per surplus copy
+        bool multiset = false;
+
+        // External and partitioned engines: memory for buffered entries,
+        // where spill files go (system temporary directory when empty) and
+        // whether they are deflated
+        size_t memoryBudget = size_t(1) << 30;
+        std::string spillDirectory;
+        bool compressSpills = false;
+
+        // Partitioned engine: hash partitions per input (0 = derived from
+        // the input sizes, budget and thread count)
+        size_t partitions = 0;
+
+        // Key-based comparison: rows are matched on these columns (header
+        // names, or 1-based positions) and changed rows are reported cell
+        // by cell. Takes precedence over `engine`.
+        std::vector<std::string> keyColumns;
+
+        // Fingerprint engine: reuse an input's index from its sidecar file
+        // (<file>.fpidx) while it is valid, and write one when it is not
+        bool sidecars = false;
+
+        // With sidecars: a CSV input that has only grown since its sidecar
+        // was written is handled by parsing just the appended bytes. The
+        // unchanged prefix is verified by checksums of its head and tail
+        // instead of a hash of the whole input.
+        bool incremental = false;
+
+        // Equality check first: both inputs are streamed once into
+        // order-independent digests, and the engine above only runs when
+        // they differ. A match reports total rows, duplicates included.
+        bool check = false;
+
+        // How cells compare: decimal places, case, whitespace and nulls.
+        // The comparator resolves these to one CellKey::Policy when it is
+        // constructed and passes it to every store and index it builds.
+        CellKey::Settings comparison;
+
+        // In-memory engine: infer column types from the leading records of
+        // CSV inputs and store integer, fixed-point and date cells packed
+        bool typedColumns = true;
+    };
+
+    FileComparator() : FileComparator(Options{}) {}
+
+    // Throws std::runtime_error for comparison settings without a policy
+    explicit FileComparator(const Options& options)
+        : options_(options), policy_(&CellKey::policyFor(options.comparison)) {}
     ~FileComparator() = default;
 
     struct ComparisonResult {
@@ -29,24 +95,77 @@ public:
         size_t file2RowCount;
         std::vector<Row> onlyInFile1;
         std::vector<Row> onlyInFile2;
+
+        // Decided by --check digests alone. No distinct set was built, so
+        // the row counts are then every row, duplicates included, where the
+        // full engines count distinct rows unless multiset.
+        bool matchedByDigest = false;
+
+        // Key-based comparisons only: onlyInFile1/onlyInFile2 hold removed
+        // and added keys, `modified` the rows whose key matched but whose
+        // other cells differ. `header` is the first row of file 1 and
+        // `keyColumns` the key positions resolved against it.
+        struct ModifiedRow {
+            Row file1;
+            Row file2;
+            std::vector<size_t> changedColumns;
+        };
+        std::vector<ModifiedRow> modified;
+        std::vector<std::string> header;
+        std::vector<size_t> keyColumns;
     };
 
     ComparisonResult compare(const std::string& file1, const std::string& file2);
     void writeRowsToCSV(const std::string& filename, const std::vector<Row>& rows);
 
+    // Stage timings and counters of everything this comparator has run
+    RunStats& stats() { return stats_; }
+
 private:
+    // Readers return the number of rows ingested (duplicates included),
+    // so no separate counting pass is needed
+
     // CSV functions
-    size_t countRowsCSV(const std::string& filename);
-    std::unordered_set<Row, Row::Hash> readCSV(const std::string& filename);
+    size_t readCSV(const std::string& filename, RowPartitions& rows);
 
     // XLSX functions
-    size_t countRowsXLSX(const std::string& filename);
-    std::unordered_set<Row, Row::Hash> readXLSX(const std::string& filename);
+    size_t readXLSX(const std::string& filename, RowPartitions& rows);
 
     // Auto-dispatch functions
-    size_t countRowsAuto(const std::string& filename);
-    std::unordered_set<Row, Row::Hash> readFileAuto(const std::string& filename);
+    size_t readFileAuto(const std::string& filename, RowPartitions& rows);
+
+    // Fingerprint engine: index pass, then a second pass over the source
+    // for the differing rows only (the files must not change in between)
+    ComparisonResult compareFingerprints(const std::string& file1, const std::string& file2);
+    size_t fingerprintFile(const std::string& filename, FingerprintIndex& index);
+    size_t fingerprintAppended(const std::string& filename, FingerprintIndex& index);
+
+    // Calls sink.reserve(estimate) and then sink.add(cells, locator) for
+    // every row; shared by the fingerprint and external engines
+    template <typename Sink>
+    size_t scanLocatedRows(const std::string& filename, Sink& sink);
+    std::vector<Row> rereadRows(const std::string& filename, const std::vector<uint64_t>& locators);
+
+    // External engine: both sides sorted out of core, then one merge walk
+    // over the two sorted streams
+    ComparisonResult compareExternal(const std::string& file1, const std::string& file2);
+
+    // Partitioned engine: scatter both inputs into hash partitions, then
+    // diff partition pairs on `threads` workers
+    ComparisonResult comparePartitioned(const std::string& file1, const std::string& file2);
+
+    // Key-based comparison: index file 1 by key, probe with file 2, re-read
+    // the removed and modified rows of file 1
+    ComparisonResult compareKeyed(const std::string& file1, const std::string& file2);
+
+    // Digest of every row of the file; CSV chunks are folded on `threads`
+    // workers and merged
+    RowDigest digestFile(const std::string& filename);
 
     // Helper to convert cell value to string
     std::string cellToString(const auto& cell);
+
+    Options options_;
+    const CellKey::Policy* policy_;  // selected from options_.comparison
+    RunStats stats_;
 };
\ No newline at end of file
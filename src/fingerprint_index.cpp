@@ -0,0 +1,161 @@
+#include "fingerprint_index.h"
+#include "cell_key_policy.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+// Seed of the second hash chain; any odd constant unrelated to 0 works
+constexpr uint64_t HIGH_SEED = 0x9E3779B97F4A7C15ull;
+
+template <typename P>
+RowFingerprint fingerprintOf(const std::vector<std::string_view>& cells) {
+    RowFingerprint fingerprint{ 0, HIGH_SEED };
+    for (const auto& cell : cells) {
+        CellKey key = P::make(cell);
+        fingerprint.lo = P::hash(fingerprint.lo, key, cell);
+        fingerprint.hi = P::hash(fingerprint.hi, key, cell);
+    }
+    return fingerprint;
+}
+
+} // namespace
+
+RowFingerprint::Function RowFingerprint::function(const CellKey::Policy& policy) {
+    return visitPolicy(policy, []<typename P>(P) { return &fingerprintOf<P>; });
+}
+
+void RowDigest::add(const RowFingerprint& fingerprint) {
+    ++count;
+    sumLo += fingerprint.lo;
+    sumHi += fingerprint.hi + (sumLo < fingerprint.lo);  // carry out of the low word
+    xorLo ^= fingerprint.lo;
+    xorHi ^= fingerprint.hi;
+}
+
+void RowDigest::merge(const RowDigest& other) {
+    count += other.count;
+    sumLo += other.sumLo;
+    sumHi += other.sumHi + (sumLo < other.sumLo);
+    xorLo ^= other.xorLo;
+    xorHi ^= other.xorHi;
+}
+
+void FingerprintIndex::add(const std::vector<std::string_view>& cells, uint64_t locator) {
+    entries_.push_back({ fingerprint_(cells), locator });
+    columns_ = std::max(columns_, cells.size());
+}
+
+FingerprintIndex FingerprintIndex::adopt(std::span<const Entry> entries, std::span<const uint32_t> counts,
+                                         size_t columns, const CellKey::Policy& policy,
+                                         std::shared_ptr<const void> owner) {
+    if (entries.size() != counts.size()) {
+        throw std::runtime_error("Fingerprint index entries and counts differ in length");
+    }
+    FingerprintIndex index(policy);
+    index.adoptedEntries_ = entries;
+    index.adoptedCounts_ = counts;
+    index.columns_ = columns;
+    index.owner_ = std::move(owner);
+    return index;
+}
+
+void FingerprintIndex::finalize() {
+    std::sort(entries_.begin(), entries_.end(), [](const Entry& a, const Entry& b) {
+        if (a.fingerprint != b.fingerprint) return a.fingerprint < b.fingerprint;
+        return a.locator < b.locator;
+    });
+
+    // Compact equal runs in place, counting them on the way
+    counts_.clear();
+    size_t distinct = 0;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        if (distinct > 0 && entries_[distinct - 1].fingerprint == entries_[i].fingerprint) {
+            if (counts_.back() == std::numeric_limits<uint32_t>::max()) {
+                throw std::runtime_error("Row occurrence count exceeds 32-bit range");
+            }
+            ++counts_.back();
+            continue;
+        }
+        entries_[distinct++] = entries_[i];
+        counts_.push_back(1);
+    }
+    entries_.resize(distinct);
+    entries_.shrink_to_fit();
+    counts_.shrink_to_fit();
+}
+
+FingerprintIndex FingerprintIndex::merge(const FingerprintIndex& a, const FingerprintIndex& b) {
+    std::span<const Entry> entriesA = a.entries();
+    std::span<const Entry> entriesB = b.entries();
+    std::span<const uint32_t> countsA = a.counts();
+    std::span<const uint32_t> countsB = b.counts();
+
+    if (a.policy_ != b.policy_) {
+        throw std::runtime_error("Fingerprint indexes of different comparison policies cannot merge");
+    }
+
+    FingerprintIndex merged(*a.policy_);
+    merged.entries_.reserve(entriesA.size() + entriesB.size());
+    merged.counts_.reserve(entriesA.size() + entriesB.size());
+    merged.columns_ = std::max(a.columns_, b.columns_);
+
+    size_t i = 0;
+    size_t j = 0;
+    while (i < entriesA.size() || j < entriesB.size()) {
+        if (j == entriesB.size() || (i < entriesA.size() && entriesA[i].fingerprint < entriesB[j].fingerprint)) {
+            merged.entries_.push_back(entriesA[i]);
+            merged.counts_.push_back(countsA[i++]);
+        }
+        else if (i == entriesA.size() || entriesB[j].fingerprint < entriesA[i].fingerprint) {
+            merged.entries_.push_back(entriesB[j]);
+            merged.counts_.push_back(countsB[j++]);
+        }
+        else {
+            uint64_t count = uint64_t(countsA[i]) + countsB[j];
+            if (count > std::numeric_limits<uint32_t>::max()) {
+                throw std::runtime_error("Row occurrence count exceeds 32-bit range");
+            }
+            merged.entries_.push_back(entriesA[i++]);
+            merged.counts_.push_back(static_cast<uint32_t>(count));
+            ++j;
+        }
+    }
+    return merged;
+}
+
+std::vector<uint64_t> FingerprintIndex::difference(const FingerprintIndex& a, const FingerprintIndex& b,
+                                                   bool multiset) {
+    std::vector<uint64_t> locators;
+    std::span<const Entry> entriesA = a.entries();
+    std::span<const Entry> entriesB = b.entries();
+    std::span<const uint32_t> countsA = a.counts();
+    std::span<const uint32_t> countsB = b.counts();
+
+    // Merge walk over the two sorted runs
+    size_t other = 0;
+    for (size_t i = 0; i < entriesA.size(); ++i) {
+        const RowFingerprint& fingerprint = entriesA[i].fingerprint;
+        while (other < entriesB.size() && entriesB[other].fingerprint < fingerprint) {
+            ++other;
+        }
+
+        uint32_t countB = 0;
+        if (other < entriesB.size() && entriesB[other].fingerprint == fingerprint) {
+            countB = countsB[other];
+        }
+
+        uint32_t surplus = 0;
+        if (multiset) {
+            surplus = countsA[i] > countB ? countsA[i] - countB : 0;
+        }
+        else {
+            surplus = countB == 0 ? 1 : 0;
+        }
+        locators.insert(locators.end(), surplus, entriesA[i].locator);
+    }
+
+    std::sort(locators.begin(), locators.end());
+    return locators;
+}
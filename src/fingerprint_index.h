@@ -0,0 +1,116 @@
+#pragma once
+
+#include "cell_key.h"
+#include <compare>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// 128-bit fingerprint of a row's canonical cells (see CellKey): two
+// independently seeded hash chains. Rows that compare equal under the
+// policy always share a fingerprint; distinct rows collide with probability
+// ~2^-128.
+struct RowFingerprint {
+    // Bump whenever cell canonicalization or the hash chains change, so
+    // fingerprints persisted by an older build are not trusted
+    static constexpr uint32_t VERSION = 2;
+
+    uint64_t lo = 0;
+    uint64_t hi = 0;
+
+    // A fingerprint loop specialised on one policy, so cells cost no
+    // indirect calls. Resolve it once with function() and call it per row.
+    using Function = RowFingerprint (*)(const std::vector<std::string_view>& cells);
+    static Function function(const CellKey::Policy& policy);
+
+    // One-off fingerprint; resolves the policy's loop on every call
+    static RowFingerprint of(const CellKey::Policy& policy, const std::vector<std::string_view>& cells) {
+        return function(policy)(cells);
+    }
+
+    auto operator<=>(const RowFingerprint&) const = default;
+};
+
+// Order-independent digest of a multiset of rows: the row count plus the
+// 128-bit sum and xor of their fingerprints. Rows can be folded in any
+// order and partial digests merged, so chunks digest in parallel. Equal
+// multisets always digest alike; different ones collide only by accident.
+struct RowDigest {
+    uint64_t count = 0;
+    uint64_t sumLo = 0;
+    uint64_t sumHi = 0;
+    uint64_t xorLo = 0;
+    uint64_t xorHi = 0;
+
+    void add(const RowFingerprint& fingerprint);
+    void merge(const RowDigest& other);
+
+    bool operator==(const RowDigest&) const = default;
+};
+
+// One side of a fingerprint-only comparison. Each row costs 24 bytes:
+// its fingerprint plus a locator that finds it again in the source file
+// (byte offset of the record for CSV, row ordinal for XLSX). finalize()
+// adds a 4-byte occurrence count per distinct row. Rows are fingerprinted
+// under the index's policy, so only indexes of one policy compare.
+class FingerprintIndex {
+public:
+    struct Entry {
+        RowFingerprint fingerprint;
+        uint64_t locator;
+    };
+
+    explicit FingerprintIndex(const CellKey::Policy& policy = CellKey::defaults())
+        : policy_(&policy), fingerprint_(RowFingerprint::function(policy)) {}
+
+    const CellKey::Policy& policy() const { return *policy_; }
+
+    void reserve(size_t rows) { entries_.reserve(rows); }
+    void add(const std::vector<std::string_view>& cells, uint64_t locator);
+    void add(const Entry& entry) { entries_.push_back(entry); }
+
+    // Sorts by fingerprint and folds duplicates into an occurrence count,
+    // keeping the first occurrence's locator
+    void finalize();
+
+    // A finalized index over arrays held elsewhere, e.g. a mapped sidecar
+    // file; `owner` keeps that memory alive. Nothing is copied.
+    static FingerprintIndex adopt(std::span<const Entry> entries, std::span<const uint32_t> counts,
+                                  size_t columns, const CellKey::Policy& policy,
+                                  std::shared_ptr<const void> owner);
+
+    // Finalized union of two finalized indexes: counts add up and a row in
+    // both keeps `a`'s locator, so `a` should be the earlier part of the
+    // input. Both must share a policy.
+    static FingerprintIndex merge(const FingerprintIndex& a, const FingerprintIndex& b);
+
+    // Distinct rows; only meaningful after finalize()
+    size_t size() const { return entries().size(); }
+
+    // Sorted distinct rows and their occurrence counts, after finalize()
+    std::span<const Entry> entries() const { return owner_ ? adoptedEntries_ : std::span<const Entry>(entries_); }
+    std::span<const uint32_t> counts() const { return owner_ ? adoptedCounts_ : std::span<const uint32_t>(counts_); }
+
+    // Most cells seen in one row added with add(cells, locator)
+    size_t columns() const { return columns_; }
+
+    // Locators of the rows of `a` whose fingerprint is absent from `b`, in
+    // ascending order so the source can be re-read front to back.
+    // With `multiset`, a row that occurs more often in `a` than in `b` is
+    // listed once per surplus copy. Both indexes must be finalized.
+    static std::vector<uint64_t> difference(const FingerprintIndex& a, const FingerprintIndex& b,
+                                            bool multiset = false);
+
+private:
+    const CellKey::Policy* policy_;
+    RowFingerprint::Function fingerprint_;
+    std::vector<Entry> entries_;
+    std::vector<uint32_t> counts_;  // occurrences, parallel to entries_ after finalize()
+    size_t columns_ = 0;
+
+    std::shared_ptr<const void> owner_;
+    std::span<const Entry> adoptedEntries_;
+    std::span<const uint32_t> adoptedCounts_;
+};
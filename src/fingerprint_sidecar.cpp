@@ -0,0 +1,217 @@
+#include "fingerprint_sidecar.h"
+#include "cell_key.h"
+#include "mapped_file.h"
+#include <wyhash.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+constexpr char MAGIC[8] = { 'F', 'P', 'S', 'I', 'D', 'E', 'C', 'R' };
+
+// Bump when the header or array layout changes
+constexpr uint32_t LAYOUT = 3;
+
+// Bytes checksummed at each end of the extent for prefix validation
+constexpr uint64_t EDGE_BYTES = 64 * 1024;
+
+struct Header {
+    char magic[8];
+    uint32_t layout;
+    uint32_t fingerprintVersion;
+    uint32_t comparePolicy;  // CellKey::Policy::id the fingerprints were hashed under
+    uint32_t reserved;
+    uint64_t fileSize;
+    int64_t modified;      // last_write_time ticks
+    uint64_t contentHash;
+    uint64_t contentHashed;  // 0 when contentHash was not computed
+    uint64_t extent;
+    uint64_t headHash;     // first EDGE_BYTES of the extent
+    uint64_t tailHash;     // last EDGE_BYTES of the extent
+    uint64_t rows;
+    uint64_t distinct;
+    uint64_t columns;
+    uint64_t pathBytes;    // absolute path follows, padded to 8 bytes
+};
+
+static_assert(std::is_trivially_copyable_v<Header>);
+static_assert(std::is_trivially_copyable_v<FingerprintIndex::Entry>);
+static_assert(sizeof(FingerprintIndex::Entry) == 24, "Entry is stored as raw 24-byte records");
+
+size_t padTo8(size_t bytes) {
+    return (bytes + 7) & ~size_t(7);
+}
+
+// What the sidecar was built from
+struct Source {
+    std::string path;
+    uint64_t size = 0;
+    int64_t modified = 0;
+};
+
+Source describe(const std::string& filename) {
+    std::filesystem::path path = std::filesystem::absolute(filename).lexically_normal();
+    Source source;
+    source.path = path.string();
+    source.size = std::filesystem::file_size(path);
+    source.modified = static_cast<int64_t>(std::filesystem::last_write_time(path).time_since_epoch().count());
+    return source;
+}
+
+uint64_t contentHash(const std::string& filename) {
+    MappedFile file(filename);
+    return wyhash(file.data().data(), file.size(), 0, _wyp);
+}
+
+// Checksums of both ends of the first `extent` bytes; only those pages of
+// the mapping are touched
+std::pair<uint64_t, uint64_t> edgeHashes(const std::string& filename, uint64_t extent) {
+    MappedFile file(filename);
+    if (file.size() < extent) {
+        return { 0, 0 };
+    }
+    size_t edge = static_cast<size_t>(std::min(extent, EDGE_BYTES));
+    std::string_view data = file.data();
+    return { wyhash(data.data(), edge, 0, _wyp),
+             wyhash(data.data() + extent - edge, edge, 0, _wyp) };
+}
+
+} // namespace
+
+std::string FingerprintSidecar::pathFor(const std::string& filename) {
+    return filename + ".fpidx";
+}
+
+std::optional<FingerprintSidecar::Loaded> FingerprintSidecar::load(const std::string& filename,
+                                                                   const CellKey::Policy& policy) {
+    return open(filename, false, policy);
+}
+
+std::optional<FingerprintSidecar::Loaded> FingerprintSidecar::loadPrefix(const std::string& filename,
+                                                                         const CellKey::Policy& policy) {
+    return open(filename, true, policy);
+}
+
+std::optional<FingerprintSidecar::Loaded> FingerprintSidecar::open(const std::string& filename, bool prefix,
+                                                                   const CellKey::Policy& policy) {
+    std::string sidecarPath = pathFor(filename);
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(sidecarPath, ec)) {
+        return std::nullopt;
+    }
+
+    auto mapping = std::make_shared<MappedFile>(sidecarPath);
+    std::string_view data = mapping->data();
+    if (data.size() < sizeof(Header)) {
+        return std::nullopt;
+    }
+
+    Header header;
+    std::memcpy(&header, data.data(), sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.layout != LAYOUT ||
+        header.fingerprintVersion != RowFingerprint::VERSION ||
+        header.comparePolicy != policy.id) {
+        return std::nullopt;
+    }
+
+    size_t entriesOffset = sizeof(Header) + padTo8(header.pathBytes);
+    size_t countsOffset = entriesOffset + header.distinct * sizeof(FingerprintIndex::Entry);
+    if (header.pathBytes > data.size() ||
+        header.distinct > data.size() / sizeof(FingerprintIndex::Entry) ||
+        countsOffset + header.distinct * sizeof(uint32_t) != data.size()) {
+        return std::nullopt;
+    }
+
+    Source source = describe(filename);
+    if (data.substr(sizeof(Header), header.pathBytes) != source.path) {
+        return std::nullopt;
+    }
+
+    if (prefix) {
+        // Appends leave the extent alone; a rewrite shows at one of its ends
+        if (header.extent == 0 || source.size < header.extent ||
+            edgeHashes(filename, header.extent) != std::pair{ header.headHash, header.tailHash }) {
+            return std::nullopt;
+        }
+    }
+    else {
+        // Cheap checks first; the content hash reads the whole input
+        if (!header.contentHashed ||
+            header.fileSize != source.size ||
+            header.modified != source.modified ||
+            header.contentHash != contentHash(filename)) {
+            return std::nullopt;
+        }
+    }
+
+    // The mapping is page aligned and every array offset a multiple of 8
+    auto entries = reinterpret_cast<const FingerprintIndex::Entry*>(data.data() + entriesOffset);
+    auto counts = reinterpret_cast<const uint32_t*>(data.data() + countsOffset);
+    size_t distinct = static_cast<size_t>(header.distinct);
+
+    return Loaded{
+        FingerprintIndex::adopt({ entries, distinct }, { counts, distinct },
+                                static_cast<size_t>(header.columns), policy, std::move(mapping)),
+        header.rows,
+        header.extent
+    };
+}
+
+void FingerprintSidecar::write(const std::string& filename, const FingerprintIndex& index, uint64_t rows,
+                               uint64_t extent, bool hashContent) {
+    Source source = describe(filename);
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.layout = LAYOUT;
+    header.fingerprintVersion = RowFingerprint::VERSION;
+    header.comparePolicy = index.policy().id;
+    header.fileSize = source.size;
+    header.modified = source.modified;
+    if (hashContent) {
+        header.contentHash = contentHash(filename);
+        header.contentHashed = 1;
+    }
+    if (extent > 0) {
+        header.extent = extent;
+        std::tie(header.headHash, header.tailHash) = edgeHashes(filename, extent);
+    }
+    header.rows = rows;
+    header.distinct = index.size();
+    header.columns = index.columns();
+    header.pathBytes = source.path.size();
+
+    std::string sidecarPath = pathFor(filename);
+    std::string temporaryPath = sidecarPath + ".tmp";
+    {
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Could not create index file: " + temporaryPath);
+        }
+
+        const char padding[8] = {};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(source.path.data(), static_cast<std::streamsize>(source.path.size()));
+        out.write(padding, static_cast<std::streamsize>(padTo8(source.path.size()) - source.path.size()));
+        out.write(reinterpret_cast<const char*>(index.entries().data()),
+                  static_cast<std::streamsize>(index.entries().size_bytes()));
+        out.write(reinterpret_cast<const char*>(index.counts().data()),
+                  static_cast<std::streamsize>(index.counts().size_bytes()));
+
+        if (!out.flush()) {
+            out.close();
+            std::filesystem::remove(temporaryPath);
+            throw std::runtime_error("Could not write index file: " + temporaryPath);
+        }
+    }
+
+    std::filesystem::rename(temporaryPath, sidecarPath);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "fingerprint_index.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// Persistent copy of one input's finalized FingerprintIndex, kept next to
+// it as "<file>.fpidx" so repeated comparisons against the same baseline
+// only parse the other input. The sidecar is a fixed header followed by the
+// index's own arrays and is used in place through a read-only mapping.
+//
+// A sidecar is only trusted while its input keeps the recorded absolute
+// path, size, modification time and content hash, and when it was written
+// with the current RowFingerprint::VERSION and the caller's comparison
+// policy; otherwise it reads as absent.
+// For append-only inputs, loadPrefix() instead accepts an input that has
+// grown, as long as the indexed extent still checksums the same.
+class FingerprintSidecar {
+public:
+    static std::string pathFor(const std::string& filename);
+
+    struct Loaded {
+        FingerprintIndex index;
+        uint64_t rows;     // rows the index was built from, duplicates included
+        uint64_t extent;   // leading bytes of the input covered, ending on a record boundary (0 = not extendable)
+    };
+
+    // Mapped index of `filename` under `policy`, or nothing if there is no
+    // valid sidecar
+    static std::optional<Loaded> load(const std::string& filename, const CellKey::Policy& policy);
+
+    // Mapped index of an unchanged prefix of `filename`, which may have
+    // grown since: the extent is checked by checksums of its first and last
+    // 64 KiB rather than by a full content hash, so the cost does not grow
+    // with the input
+    static std::optional<Loaded> loadPrefix(const std::string& filename, const CellKey::Policy& policy);
+
+    // `index` must be finalized; its policy is recorded. `extent` is where appended records would
+    // start, i.e. the input ends there on a record boundary (0 when that is
+    // not known, which rules out loadPrefix()). Without `hashContent` the
+    // sidecar is only usable through loadPrefix().
+    // Written under a temporary name and renamed into place, so a concurrent
+    // reader never sees a partial sidecar.
+    static void write(const std::string& filename, const FingerprintIndex& index, uint64_t rows,
+                      uint64_t extent = 0, bool hashContent = true);
+
+private:
+    static std::optional<Loaded> open(const std::string& filename, bool prefix, const CellKey::Policy& policy);
+};
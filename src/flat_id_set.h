@@ -0,0 +1,224 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLAT_ID_SET_SSE2
+#include <emmintrin.h>
+#endif
+
+// Open-addressing hash set of row ids in the style of Swiss tables.
+// Slots come in groups of 16 with one control byte each: EMPTY, or the low
+// 7 bits of the row hash. A probe matches a whole group's control bytes at
+// once (one SSE2 compare) and only visits rows whose bits match, so a miss
+// rarely touches row data at all. A slot costs a 4-byte id plus its
+// control byte, versus a heap node and a bucket pointer per row in
+// std::unordered_set.
+//
+// Hashes and equality come from `Store`, which must provide
+// hash(id) and equals(id, const Store& other, otherId).
+template <typename Store>
+class FlatIdSet {
+public:
+    using Id = uint32_t;
+    static constexpr Id NONE = ~Id(0);
+
+    explicit FlatIdSet(const Store* store)
+        : store_(store) {
+    }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return ids_.size(); }
+
+    // Lookups so far (inserts included) and the control groups they visited
+    uint64_t lookups() const { return lookups_; }
+    uint64_t groupProbes() const { return groupProbes_; }
+
+    // Sizes the table so that `count` ids fit without rehashing
+    void reserve(size_t count) {
+        size_t needed = count + count / 7 + 1;
+        if (needed > maxLoad(capacity())) {
+            rehash(std::bit_ceil(std::max<size_t>(needed, GROUP)));
+        }
+    }
+
+    // Inserts `id` unless an equal row is present. Returns the id held for
+    // the row (the earlier one for duplicates) and whether it was inserted.
+    std::pair<Id, bool> insert(Id id) {
+        if (size_ + 1 > maxLoad(capacity())) {
+            rehash(std::max<size_t>(capacity() * 2, GROUP));
+        }
+
+        uint64_t hash = store_->hash(id);
+        size_t slot = findSlot(hash, *store_, id);
+        if (slot != NOT_FOUND) {
+            return { ids_[slot], false };
+        }
+
+        place(hash, id);
+        ++size_;
+        return { id, true };
+    }
+
+    // Id of the row equal to other's row `otherId`, or NONE
+    Id find(const Store& other, Id otherId) const {
+        if (size_ == 0) {
+            return NONE;
+        }
+        size_t slot = findSlot(other.hash(otherId), other, otherId);
+        return slot == NOT_FOUND ? NONE : ids_[slot];
+    }
+
+    bool contains(const Store& other, Id otherId) const {
+        return find(other, otherId) != NONE;
+    }
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Id;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Id*;
+        using reference = Id;
+
+        const_iterator(const FlatIdSet* set, size_t slot)
+            : set_(set), slot_(slot) {
+            skipEmpty();
+        }
+
+        Id operator*() const { return set_->ids_[slot_]; }
+
+        const_iterator& operator++() {
+            ++slot_;
+            skipEmpty();
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const const_iterator& other) const { return slot_ == other.slot_; }
+        bool operator!=(const const_iterator& other) const { return slot_ != other.slot_; }
+
+    private:
+        void skipEmpty() {
+            while (slot_ < set_->ctrl_.size() && set_->ctrl_[slot_] == EMPTY) ++slot_;
+        }
+
+        const FlatIdSet* set_;
+        size_t slot_;
+    };
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, ctrl_.size()); }
+
+private:
+    static constexpr size_t GROUP = 16;
+    static constexpr uint8_t EMPTY = 0x80;
+    static constexpr size_t NOT_FOUND = ~size_t(0);
+
+    // 7/8 maximum load factor
+    static size_t maxLoad(size_t capacity) { return capacity - capacity / 8; }
+
+    static uint8_t h2(uint64_t hash) { return static_cast<uint8_t>(hash & 0x7F); }
+    size_t firstGroup(uint64_t hash) const { return static_cast<size_t>(hash >> 7) & groupMask_; }
+
+    // Bit i set where control byte i of the group equals `value`
+    static uint32_t matchByte(const uint8_t* group, uint8_t value) {
+#if defined(FLAT_ID_SET_SSE2)
+        __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(static_cast<char>(value)))));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < GROUP; ++i) {
+            if (group[i] == value) mask |= uint32_t(1) << i;
+        }
+        return mask;
+#endif
+    }
+
+    // Bit i set where slot i of the group is empty
+    static uint32_t matchEmpty(const uint8_t* group) {
+#if defined(FLAT_ID_SET_SSE2)
+        __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+        return static_cast<uint32_t>(_mm_movemask_epi8(ctrl));
+#else
+        return matchByte(group, EMPTY);
+#endif
+    }
+
+    size_t findSlot(uint64_t hash, const Store& other, Id otherId) const {
+        if (ids_.empty()) {
+            return NOT_FOUND;
+        }
+
+        uint8_t tag = h2(hash);
+        size_t group = firstGroup(hash);
+        ++lookups_;
+
+        // Triangular probing over groups visits every group once
+        for (size_t step = 1;; ++step) {
+            ++groupProbes_;
+            const uint8_t* ctrl = ctrl_.data() + group * GROUP;
+            for (uint32_t match = matchByte(ctrl, tag); match != 0; match &= match - 1) {
+                size_t slot = group * GROUP + static_cast<size_t>(std::countr_zero(match));
+                if (store_->equals(ids_[slot], other, otherId)) {
+                    return slot;
+                }
+            }
+            if (matchEmpty(ctrl) != 0) {
+                return NOT_FOUND;
+            }
+            group = (group + step) & groupMask_;
+        }
+    }
+
+    // Puts `id` in the first empty slot of its probe sequence. Nothing is
+    // ever erased, so that is where findSlot() stops looking.
+    void place(uint64_t hash, Id id) {
+        size_t group = firstGroup(hash);
+        for (size_t step = 1;; ++step) {
+            uint32_t empty = matchEmpty(ctrl_.data() + group * GROUP);
+            if (empty != 0) {
+                size_t slot = group * GROUP + static_cast<size_t>(std::countr_zero(empty));
+                ctrl_[slot] = h2(hash);
+                ids_[slot] = id;
+                return;
+            }
+            group = (group + step) & groupMask_;
+        }
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<uint8_t> oldCtrl(capacity, EMPTY);
+        std::vector<Id> oldIds(capacity);
+        oldCtrl.swap(ctrl_);
+        oldIds.swap(ids_);
+        groupMask_ = capacity / GROUP - 1;
+
+        for (size_t slot = 0; slot < oldCtrl.size(); ++slot) {
+            if (oldCtrl[slot] != EMPTY) {
+                place(store_->hash(oldIds[slot]), oldIds[slot]);
+            }
+        }
+    }
+
+    const Store* store_;
+    std::vector<uint8_t> ctrl_;  // one control byte per slot, capacity a power of two
+    std::vector<Id> ids_;
+    size_t groupMask_ = 0;
+    size_t size_ = 0;
+
+    // Statistics only; a set is probed by one thread at a time
+    mutable uint64_t lookups_ = 0;
+    mutable uint64_t groupProbes_ = 0;
+};
@@ -0,0 +1,81 @@
+#include "key_index.h"
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+KeyIndex::KeyIndex(std::vector<std::string> keyNames, const CellKey::Policy& policy)
+    : fingerprint_(RowFingerprint::function(policy))
+    , keyNames_(std::move(keyNames))
+    , table_(policy)
+    , probe_(policy) {
+    if (keyNames_.empty()) {
+        throw std::runtime_error("At least one key column is required");
+    }
+}
+
+void KeyIndex::reserve(size_t rows) {
+    table_.reserve(rows, 0);
+    locators_.reserve(rows);
+    payloads_.reserve(rows);
+}
+
+void KeyIndex::resolveKeyColumns(const std::vector<std::string_view>& header) {
+    header_.assign(header.begin(), header.end());
+
+    for (const auto& name : keyNames_) {
+        auto named = std::find(header.begin(), header.end(), name);
+        if (named != header.end()) {
+            keyColumns_.push_back(static_cast<size_t>(named - header.begin()));
+            continue;
+        }
+
+        size_t position = 0;
+        auto [ptr, ec] = std::from_chars(name.data(), name.data() + name.size(), position);
+        if (ec != std::errc() || ptr != name.data() + name.size() || position == 0 || position > header.size()) {
+            throw std::runtime_error("Key column not found in header: " + name);
+        }
+        keyColumns_.push_back(position - 1);
+    }
+}
+
+const std::vector<std::string_view>& KeyIndex::keyCells(const std::vector<std::string_view>& cells) {
+    // Short rows have empty key cells
+    keyScratch_.clear();
+    for (size_t column : keyColumns_) {
+        keyScratch_.push_back(column < cells.size() ? cells[column] : std::string_view());
+    }
+    return keyScratch_;
+}
+
+void KeyIndex::add(const std::vector<std::string_view>& cells, uint64_t locator) {
+    if (keyColumns_.empty()) {
+        resolveKeyColumns(cells);
+    }
+
+    if (!table_.insert(keyCells(cells))) {
+        ++duplicates_;
+        return;
+    }
+    locators_.push_back(locator);
+    payloads_.push_back(payloadOf(cells));
+}
+
+KeyIndex::Id KeyIndex::find(const std::vector<std::string_view>& cells) {
+    if (keyColumns_.empty()) {
+        return NOT_FOUND;
+    }
+    Id probe = probe_.append(keyCells(cells));
+    Id id = table_.find(probe_, probe);
+    probe_.popBack();
+    return id;
+}
+
+RowFingerprint KeyIndex::payloadOf(const std::vector<std::string_view>& cells) const {
+    payloadScratch_.clear();
+    for (size_t column = 0; column < cells.size(); ++column) {
+        if (std::find(keyColumns_.begin(), keyColumns_.end(), column) == keyColumns_.end()) {
+            payloadScratch_.push_back(cells[column]);
+        }
+    }
+    return fingerprint_(payloadScratch_);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "fingerprint_index.h"
+#include "row_store.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Hash index on the key columns of one input, for key-based comparisons.
+// Only the key cells are stored. The rest of a row is represented by a
+// fingerprint of its non-key cells plus a locator (byte offset for CSV, row
+// ordinal for XLSX), so a probe can tell "unchanged" from "modified" without
+// the payload and the differing rows are re-read from the source afterwards.
+//
+// The first row added is the header; key columns are resolved against it
+// by name (or as 1-based positions when no header cell matches).
+class KeyIndex {
+public:
+    using Id = RowStore::RowId;
+    static constexpr Id NOT_FOUND = RowTable::NOT_FOUND;
+
+    // Keys and payloads compare under `policy`
+    KeyIndex(std::vector<std::string> keyNames, const CellKey::Policy& policy);
+
+    // Sink interface shared with FingerprintIndex
+    void reserve(size_t rows);
+    void add(const std::vector<std::string_view>& cells, uint64_t locator);
+
+    // Row with the same key cells (CellKey equality), or NOT_FOUND
+    Id find(const std::vector<std::string_view>& cells);
+
+    size_t size() const { return table_.size(); }
+    const RowTable& table() const { return table_; }
+    uint64_t locator(Id id) const { return locators_[id]; }
+    const RowFingerprint& payload(Id id) const { return payloads_[id]; }
+
+    // Rows whose key repeats an earlier row's; only the first is indexed
+    size_t duplicates() const { return duplicates_; }
+
+    const std::vector<std::string>& header() const { return header_; }
+    const std::vector<size_t>& keyColumns() const { return keyColumns_; }
+
+    // Fingerprint of the cells outside the key columns
+    RowFingerprint payloadOf(const std::vector<std::string_view>& cells) const;
+
+private:
+    void resolveKeyColumns(const std::vector<std::string_view>& header);
+    const std::vector<std::string_view>& keyCells(const std::vector<std::string_view>& cells);
+
+    RowFingerprint::Function fingerprint_;
+    std::vector<std::string> keyNames_;
+    std::vector<size_t> keyColumns_;
+    std::vector<std::string> header_;
+
+    RowTable table_;                       // key cells only
+    std::vector<uint64_t> locators_;       // indexed by key row id
+    std::vector<RowFingerprint> payloads_; // indexed by key row id
+    size_t duplicates_ = 0;
+
+    RowStore probe_;                       // holds the key being looked up
+    std::vector<std::string_view> keyScratch_;
+    mutable std::vector<std::string_view> payloadScratch_;
+};
@@ -1,7 +1,14 @@
 ﻿#include "file_comparator.h"
 #include <iostream>
+#include <algorithm>
+#include <charconv>
 #include <cstdio>
+#include <fstream>
 #include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 std::string formatRow(const Row& row) {
     std::ostringstream oss;
@@ -14,26 +21,262 @@ std::string formatRow(const Row& row) {
     return oss.str();
 }
 
+// Parses a byte count with an optional K, M or G suffix (powers of 1024)
+bool parseSize(std::string_view value, size_t& bytes) {
+    size_t shift = 0;
+    if (!value.empty()) {
+        switch (value.back()) {
+        case 'K': case 'k': shift = 10; break;
+        case 'M': case 'm': shift = 20; break;
+        case 'G': case 'g': shift = 30; break;
+        default: break;
+        }
+        if (shift != 0) value.remove_suffix(1);
+    }
+
+    auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), bytes);
+    if (ec != std::errc() || ptr != value.data() + value.size() || bytes == 0) {
+        return false;
+    }
+    bytes <<= shift;
+    return true;
+}
+
+// Splits "a,b,c" into its non-empty items
+std::vector<std::string> splitList(std::string_view list) {
+    std::vector<std::string> items;
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        std::string_view item = list.substr(0, comma);
+        if (!item.empty()) items.emplace_back(item);
+        list.remove_prefix(comma == std::string_view::npos ? list.size() : comma + 1);
+    }
+    return items;
+}
+
+// Header name of a column, or its 1-based position past the header
+std::string columnName(const std::vector<std::string>& header, size_t column) {
+    return column < header.size() ? header[column] : "#" + std::to_string(column + 1);
+}
+
+std::string engineName(const FileComparator::Options& options) {
+    if (!options.keyColumns.empty()) return "keyed";
+    switch (options.engine) {
+    case FileComparator::Engine::Fingerprint: return "fingerprint";
+    case FileComparator::Engine::External: return "external";
+    case FileComparator::Engine::Partitioned: return "partitioned";
+    default: return "in-memory";
+    }
+}
+
+// JSON performance report to `path`, or stderr when empty
+void writeStats(FileComparator& comparator, const FileComparator::Options& options,
+                const std::string& file1, const std::string& file2,
+                const FileComparator::ComparisonResult& result, const std::string& path) {
+    RunStats& stats = comparator.stats();
+    stats.setField("file1", file1);
+    stats.setField("file2", file2);
+    stats.setField("engine", engineName(options));
+    stats.setField("threads", static_cast<uint64_t>(options.threads));
+    stats.setField("check", options.check);
+    stats.setField("sidecars", options.sidecars);
+    stats.setField("incremental", options.incremental);
+    stats.setField("decimal_places", static_cast<uint64_t>(options.comparison.decimalPlaces));
+    stats.setField("ignore_case", options.comparison.foldCase);
+    stats.setField("trim", options.comparison.trim);
+    stats.setField("nulls_equal", options.comparison.nullsEqual);
+    stats.setField("files_match", result.filesMatch);
+    if (result.matchedByDigest) {
+        // All rows, duplicates included; file1_rows is what the full engines
+        // report, distinct rows unless --multiset
+        stats.setField("file1_rows_total", static_cast<uint64_t>(result.file1RowCount));
+        stats.setField("file2_rows_total", static_cast<uint64_t>(result.file2RowCount));
+    }
+    else {
+        stats.setField("file1_rows", static_cast<uint64_t>(result.file1RowCount));
+        stats.setField("file2_rows", static_cast<uint64_t>(result.file2RowCount));
+    }
+    stats.setField("only_in_file1", static_cast<uint64_t>(result.onlyInFile1.size()));
+    stats.setField("only_in_file2", static_cast<uint64_t>(result.onlyInFile2.size()));
+    stats.setField("modified", static_cast<uint64_t>(result.modified.size()));
+
+    if (path.empty()) {
+        std::cerr << stats.toJson();
+        return;
+    }
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("Could not open stats file: " + path);
+    }
+    out << stats.toJson();
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options] <file1> <file2>" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "File Comparator - High-performance file comparison" << std::endl;
+    std::cerr << "Compares two CSV or XLSX files and reports differences." << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "Supported formats:" << std::endl;
+    std::cerr << "  - CSV  (.csv)" << std::endl;
+    std::cerr << "  - XLSX (.xlsx)" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "Features:" << std::endl;
+    std::cerr << "  - Order-independent comparison" << std::endl;
+    std::cerr << "  - Decimal numbers compared to 4 decimal places (see --decimals)" << std::endl;
+    std::cerr << "  - Mixed format comparison (CSV vs XLSX)" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  --fingerprint   Keep only a 24-byte fingerprint per row in memory and" << std::endl;
+    std::cerr << "                  re-read the differing rows from disk afterwards" << std::endl;
+    std::cerr << "  --threads N     Parse CSV input and diff on N threads (0 = all cores)" << std::endl;
+    std::cerr << "  --multiset      Count duplicate rows; report each surplus copy as a difference" << std::endl;
+    std::cerr << "  --external      Sort fingerprints in runs spilled to disk, for inputs larger" << std::endl;
+    std::cerr << "                  than memory; differing rows are re-read from disk afterwards" << std::endl;
+    std::cerr << "  --partitioned   Scatter fingerprints into hash partitions (spilled to disk" << std::endl;
+    std::cerr << "                  over budget) and diff partition pairs on --threads workers" << std::endl;
+    std::cerr << "  --partitions N        Hash partitions for --partitioned (default: automatic)" << std::endl;
+    std::cerr << "  --memory-budget SIZE  Memory for --external/--partitioned, e.g. 512M or 8G (default 1G)" << std::endl;
+    std::cerr << "  --spill-dir DIR       Directory for spill files (default: temp dir)" << std::endl;
+    std::cerr << "  --compress-spills     Deflate spill files" << std::endl;
+    std::cerr << "  --key COLUMNS   Match rows on comma-separated key columns (header names or" << std::endl;
+    std::cerr << "                  1-based positions) and report changed cells of matched rows" << std::endl;
+    std::cerr << "  --index         Fingerprint engine that keeps each input's index in a" << std::endl;
+    std::cerr << "                  <file>.fpidx sidecar and reuses it while the input is unchanged" << std::endl;
+    std::cerr << "  --incremental   --index for append-only CSV feeds: only bytes appended since" << std::endl;
+    std::cerr << "                  the sidecar was written are parsed" << std::endl;
+    std::cerr << "  --check         Compare order-independent digests of both files first; the" << std::endl;
+    std::cerr << "                  full comparison only runs when they differ" << std::endl;
+    std::cerr << "  --decimals N    Round numbers to N decimal places before comparing (0-8, default 4)" << std::endl;
+    std::cerr << "  --ignore-case   Compare text ASCII case-insensitively" << std::endl;
+    std::cerr << "  --trim          Ignore whitespace around every cell, quoted cells included" << std::endl;
+    std::cerr << "  --nulls-equal   Treat empty, NULL, NA, N/A, #N/A and NaN cells as the same value" << std::endl;
+    std::cerr << "  --stats=json    Write a JSON report of per-stage wall/CPU time, throughput," << std::endl;
+    std::cerr << "                  peak RSS, hash-table probes and thread utilization to stderr" << std::endl;
+    std::cerr << "  --stats-file PATH     Write the --stats report to PATH instead" << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "Examples:" << std::endl;
+    std::cerr << "  " << program << " data1.csv data2.csv" << std::endl;
+    std::cerr << "  " << program << " report1.xlsx report2.xlsx" << std::endl;
+    std::cerr << "  " << program << " --fingerprint export.csv backup.xlsx" << std::endl;
+    std::cerr << "  " << program << " --threads 0 positions1.csv positions2.csv" << std::endl;
+    std::cerr << "  " << program << " --multiset trades1.csv trades2.csv" << std::endl;
+    std::cerr << "  " << program << " --external --memory-budget 8G --spill-dir /scratch q4_1.csv q4_2.csv" << std::endl;
+    std::cerr << "  " << program << " --key TradeId,Leg trades1.csv trades2.csv" << std::endl;
+    std::cerr << "  " << program << " --check --threads 0 eod1.csv eod2.csv" << std::endl;
+    std::cerr << "  " << program << " --index golden.csv daily_20250930.csv" << std::endl;
+    std::cerr << "  " << program << " --decimals 2 --ignore-case --nulls-equal legacy.csv migrated.csv" << std::endl;
+}
+
 int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " <file1> <file2>" << std::endl;
-        std::cerr << std::endl;
-        std::cerr << "File Comparator - High-performance file comparison" << std::endl;
-        std::cerr << "Compares two CSV or XLSX files and reports differences." << std::endl;
-        std::cerr << std::endl;
-        std::cerr << "Supported formats:" << std::endl;
-        std::cerr << "  - CSV  (.csv)" << std::endl;
-        std::cerr << "  - XLSX (.xlsx)" << std::endl;
-        std::cerr << std::endl;
-        std::cerr << "Features:" << std::endl;
-        std::cerr << "  - Order-independent comparison" << std::endl;
-        std::cerr << "  - Decimal numbers compared to 4 decimal places" << std::endl;
-        std::cerr << "  - Mixed format comparison (CSV vs XLSX)" << std::endl;
-        std::cerr << std::endl;
-        std::cerr << "Examples:" << std::endl;
-        std::cerr << "  " << argv[0] << " data1.csv data2.csv" << std::endl;
-        std::cerr << "  " << argv[0] << " report1.xlsx report2.xlsx" << std::endl;
-        std::cerr << "  " << argv[0] << " export.csv backup.xlsx" << std::endl;
+    FileComparator::Options options;
+    std::vector<std::string> files;
+    bool stats = false;
+    std::string statsFile;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--fingerprint") {
+            options.engine = FileComparator::Engine::Fingerprint;
+        }
+        else if (arg == "--multiset") {
+            options.multiset = true;
+        }
+        else if (arg == "--check") {
+            options.check = true;
+        }
+        else if (arg == "--index") {
+            options.engine = FileComparator::Engine::Fingerprint;
+            options.sidecars = true;
+        }
+        else if (arg == "--incremental") {
+            options.engine = FileComparator::Engine::Fingerprint;
+            options.sidecars = true;
+            options.incremental = true;
+        }
+        else if (arg == "--decimals" && i + 1 < argc) {
+            std::string_view value = argv[++i];
+            int places = -1;
+            auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), places);
+            if (ec != std::errc() || ptr != value.data() + value.size() ||
+                places < 0 || places > CellKey::MAX_DECIMAL_PLACES) {
+                std::cerr << "Invalid decimal places: " << value << std::endl;
+                return 1;
+            }
+            options.comparison.decimalPlaces = places;
+        }
+        else if (arg == "--ignore-case") {
+            options.comparison.foldCase = true;
+        }
+        else if (arg == "--trim") {
+            options.comparison.trim = true;
+        }
+        else if (arg == "--nulls-equal") {
+            options.comparison.nullsEqual = true;
+        }
+        else if (arg == "--external") {
+            options.engine = FileComparator::Engine::External;
+        }
+        else if (arg == "--partitioned") {
+            options.engine = FileComparator::Engine::Partitioned;
+        }
+        else if (arg == "--partitions" && i + 1 < argc) {
+            std::string_view value = argv[++i];
+            auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), options.partitions);
+            if (ec != std::errc() || ptr != value.data() + value.size()) {
+                std::cerr << "Invalid partition count: " << value << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--memory-budget" && i + 1 < argc) {
+            std::string_view value = argv[++i];
+            if (!parseSize(value, options.memoryBudget)) {
+                std::cerr << "Invalid memory budget: " << value << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--spill-dir" && i + 1 < argc) {
+            options.spillDirectory = argv[++i];
+        }
+        else if (arg == "--compress-spills") {
+            options.compressSpills = true;
+        }
+        else if (arg == "--stats=json") {
+            stats = true;
+        }
+        else if (arg == "--stats-file" && i + 1 < argc) {
+            stats = true;
+            statsFile = argv[++i];
+        }
+        else if (arg == "--key" && i + 1 < argc) {
+            options.keyColumns = splitList(argv[++i]);
+            if (options.keyColumns.empty()) {
+                std::cerr << "Invalid key columns: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            std::string_view value = argv[++i];
+            size_t threads = 0;
+            auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), threads);
+            if (ec != std::errc() || ptr != value.data() + value.size()) {
+                std::cerr << "Invalid thread count: " << value << std::endl;
+                return 1;
+            }
+            options.threads = threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads;
+        }
+        else if (arg.starts_with("--")) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+        else {
+            files.push_back(arg);
+        }
+    }
+
+    if (files.size() != 2) {
+        printUsage(argv[0]);
         return 1;
     }
 
@@ -42,10 +285,10 @@ int main(int argc, char* argv[]) {
 		//std::string file1 = R"(C:\Suhas\duck_file_nport_fund_bbh(dn)_ssb(dn)_debug.20250930.xlsx)";
         //std::string file2 = R"(C:\Suhas\henry_file_nport_fund_bbh(dn)_ssb(dn)_debug.20250930.xlsx)";
 
-        std::string file1 = argv[1];
-        std::string file2 = argv[2];
+        std::string file1 = files[0];
+        std::string file2 = files[1];
 
-        FileComparator comparator;
+        FileComparator comparator(options);
         auto result = comparator.compare(file1, file2);
 
         std::cout << std::endl;
@@ -53,11 +296,17 @@ int main(int argc, char* argv[]) {
         if (result.filesMatch) {
             std::cout << "FILES MATCH" << std::endl;
             std::cout << "Both files contain the same " << result.file1RowCount
-                << " rows (including headers, ignoring order)." << std::endl;
-            std::cout << "Decimal comparison: first 4 decimal places only." << std::endl;
+                << (result.matchedByDigest ? " rows (duplicates included, " : " rows (")
+                << "including headers, ignoring order)." << std::endl;
+            std::cout << "Numbers compared to " << options.comparison.decimalPlaces << " decimal places";
+            if (options.comparison.foldCase) std::cout << ", case ignored";
+            if (options.comparison.trim) std::cout << ", whitespace trimmed";
+            if (options.comparison.nullsEqual) std::cout << ", null-like values equal";
+            std::cout << "." << std::endl;
 
             std::remove("only_in_file1.csv");
             std::remove("only_in_file2.csv");
+            std::remove("modified_rows.csv");
         }
         else {
             std::cout << "FILES DIFFER" << std::endl;
@@ -68,6 +317,9 @@ int main(int argc, char* argv[]) {
             std::cout << "  File 2 rows: " << result.file2RowCount << std::endl;
             std::cout << "  Rows only in File 1: " << result.onlyInFile1.size() << std::endl;
             std::cout << "  Rows only in File 2: " << result.onlyInFile2.size() << std::endl;
+            if (!options.keyColumns.empty()) {
+                std::cout << "  Rows modified: " << result.modified.size() << std::endl;
+            }
             std::cout << std::endl;
 
             if (!result.onlyInFile1.empty()) {
@@ -96,22 +348,70 @@ int main(int argc, char* argv[]) {
                 std::cout << std::endl;
             }
 
+            // One output line per changed cell: key cells, column, both values
+            std::vector<Row> cellChanges;
+            if (!result.modified.empty()) {
+                std::cout << "Modified rows:" << std::endl;
+                size_t displayCount = std::min(result.modified.size(), size_t(10));
+                for (size_t i = 0; i < result.modified.size(); ++i) {
+                    const auto& modified = result.modified[i];
+                    if (i < displayCount) {
+                        std::cout << "  " << formatRow(modified.file2) << std::endl;
+                    }
+                    for (size_t column : modified.changedColumns) {
+                        std::string value1 = column < modified.file1.columns.size() ? modified.file1.columns[column] : "";
+                        std::string value2 = column < modified.file2.columns.size() ? modified.file2.columns[column] : "";
+                        if (i < displayCount) {
+                            std::cout << "    " << columnName(result.header, column) << ": \""
+                                << value1 << "\" -> \"" << value2 << "\"" << std::endl;
+                        }
+
+                        Row change;
+                        for (size_t keyColumn : result.keyColumns) {
+                            change.columns.push_back(keyColumn < modified.file2.columns.size()
+                                ? modified.file2.columns[keyColumn] : "");
+                        }
+                        change.columns.push_back(columnName(result.header, column));
+                        change.columns.push_back(value1);
+                        change.columns.push_back(value2);
+                        cellChanges.push_back(std::move(change));
+                    }
+                }
+                if (result.modified.size() > 10) {
+                    std::cout << "  ... and " << (result.modified.size() - 10)
+                        << " more rows" << std::endl;
+                }
+                std::cout << std::endl;
+            }
+
             comparator.writeRowsToCSV("only_in_file1.csv", result.onlyInFile1);
             comparator.writeRowsToCSV("only_in_file2.csv", result.onlyInFile2);
+            if (!options.keyColumns.empty()) {
+                Row header;
+                for (size_t keyColumn : result.keyColumns) {
+                    header.columns.push_back(columnName(result.header, keyColumn));
+                }
+                header.columns.insert(header.columns.end(), { "Column", "File 1", "File 2" });
+                cellChanges.insert(cellChanges.begin(), std::move(header));
+                comparator.writeRowsToCSV("modified_rows.csv", cellChanges);
+            }
 
             std::cout << "Output files created:" << std::endl;
             std::cout << "  only_in_file1.csv (" << result.onlyInFile1.size() << " rows)" << std::endl;
             std::cout << "  only_in_file2.csv (" << result.onlyInFile2.size() << " rows)" << std::endl;
+            if (!options.keyColumns.empty()) {
+                std::cout << "  modified_rows.csv (" << cellChanges.size() - 1 << " changed cells)" << std::endl;
+            }
             std::cout << std::endl;
-
-            return 1;
         }
 
+        if (stats) {
+            writeStats(comparator, options, file1, file2, result, statsFile);
+        }
+        return result.filesMatch ? 0 : 1;
     }
     catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
     }
-
-    return 0;
 }
\ No newline at end of file
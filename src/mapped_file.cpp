@@ -0,0 +1,95 @@
+#include "mapped_file.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& filename) {
+    // FILE_FLAG_SEQUENTIAL_SCAN is the Windows counterpart of MADV_SEQUENTIAL
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Could not open file: " + filename);
+    }
+    fileHandle_ = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        throw std::runtime_error("Could not stat file: " + filename);
+    }
+    size_ = static_cast<size_t>(fileSize.QuadPart);
+
+    // Zero-length files cannot be mapped; expose an empty view instead
+    if (size_ == 0) {
+        return;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        throw std::runtime_error("Could not map file: " + filename);
+    }
+    mappingHandle_ = mapping;
+
+    data_ = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (data_ == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("Could not map file: " + filename);
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (data_) UnmapViewOfFile(data_);
+    if (mappingHandle_) CloseHandle(static_cast<HANDLE>(mappingHandle_));
+    if (fileHandle_) CloseHandle(static_cast<HANDLE>(fileHandle_));
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& filename) {
+    fd_ = ::open(filename.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        throw std::runtime_error("Could not open file: " + filename);
+    }
+
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) {
+        ::close(fd_);
+        throw std::runtime_error("Could not stat file: " + filename);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+
+    // Zero-length files cannot be mapped; expose an empty view instead
+    if (size_ == 0) {
+        return;
+    }
+
+    void* addr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (addr == MAP_FAILED) {
+        ::close(fd_);
+        throw std::runtime_error("Could not map file: " + filename);
+    }
+    data_ = static_cast<const char*>(addr);
+
+    // Hint only; failure just means less aggressive read-ahead
+    ::madvise(addr, size_, MADV_SEQUENTIAL);
+}
+
+MappedFile::~MappedFile() {
+    if (data_) ::munmap(const_cast<char*>(data_), size_);
+    if (fd_ >= 0) ::close(fd_);
+}
+
+#endif
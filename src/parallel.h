@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// Runs fn(worker) for worker in [0, workers) on its own thread and waits for
+// all of them. The first exception thrown by a worker is rethrown here.
+// A single worker runs inline on the calling thread.
+template <typename Fn>
+void runParallel(size_t workers, Fn&& fn) {
+    if (workers <= 1) {
+        fn(size_t(0));
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(workers);
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+
+    for (size_t w = 0; w < workers; ++w) {
+        threads.emplace_back([&fn, &errors, w]() {
+            try {
+                fn(w);
+            }
+            catch (...) {
+                errors[w] = std::current_exception();
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
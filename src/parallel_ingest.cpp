@@ -0,0 +1,121 @@
+#include "parallel_ingest.h"
+#include "csv_parser.h"
+#include "csv_tokenizer.h"
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+std::vector<size_t> ParallelCSVIngest::chunkBoundaries(std::string_view data, size_t chunks) {
+    chunks = std::max<size_t>(chunks, 1);
+
+    std::vector<size_t> nominal(chunks + 1);
+    for (size_t i = 0; i <= chunks; ++i) {
+        nominal[i] = data.size() / chunks * i + std::min(i, data.size() % chunks);
+    }
+
+    // Quote parity at each nominal cut: count quotes per range in parallel,
+    // then prefix-sum. Only the parity matters, so nothing is speculative.
+    std::vector<size_t> quotes(chunks);
+    runParallel(chunks, [&](size_t i) {
+        quotes[i] = CSVTokenizer::countByte(data.substr(nominal[i], nominal[i + 1] - nominal[i]), '"');
+    });
+
+    std::vector<size_t> boundaries(chunks + 1);
+    boundaries[0] = 0;
+    boundaries[chunks] = data.size();
+
+    size_t quotesBefore = 0;
+    for (size_t i = 1; i < chunks; ++i) {
+        quotesBefore += quotes[i - 1];
+
+        // Snap forward to just past the first newline outside quotes
+        bool quoted = (quotesBefore & 1) != 0;
+        size_t pos = std::max(nominal[i], boundaries[i - 1]);
+        if (pos > nominal[i]) {
+            // A previous cut already ran past this one
+            boundaries[i] = pos;
+            continue;
+        }
+        for (; pos < data.size(); ++pos) {
+            if (data[pos] == '"') {
+                quoted = !quoted;
+            }
+            else if (data[pos] == '\n' && !quoted) {
+                ++pos;
+                break;
+            }
+        }
+        boundaries[i] = pos;
+    }
+
+    return boundaries;
+}
+
+size_t ParallelCSVIngest::ingest(std::string_view data, RowPartitions& rows) {
+    size_t workers = rows.count();
+    std::vector<size_t> boundaries = chunkBoundaries(data, workers);
+
+    // Phase 1: each worker deduplicates its range into a private table,
+    // where a repeated row only bumps a count, and sorts the distinct rows
+    // by owning partition
+    std::vector<std::unique_ptr<RowTable>> local(workers);
+    std::vector<std::vector<std::vector<RowStore::RowId>>> routes(workers,
+        std::vector<std::vector<RowStore::RowId>>(rows.count()));
+    std::vector<size_t> counts(workers, 0);
+
+    runParallel(workers, [&](size_t w) {
+        std::string_view chunk = data.substr(boundaries[w], boundaries[w + 1] - boundaries[w]);
+        local[w] = std::make_unique<RowTable>(rows.policy(), rows.schema());
+        RowTable& table = *local[w];
+
+        // Row slots only; arena bytes grow with the distinct rows kept
+        table.reserve(CSVTokenizer::estimateRecords(chunk), 0);
+
+        CSVRecordReader reader(chunk);
+        std::vector<std::string_view> fields;
+        std::string scratch;
+        while (reader.next(fields, scratch)) {
+            if (table.insert(fields)) {
+                RowStore::RowId id = static_cast<RowStore::RowId>(table.store().size() - 1);
+                routes[w][rows.partitionOf(table.store().hash(id))].push_back(id);
+            }
+            ++counts[w];
+        }
+    });
+
+    // Phase 2: each partition merges the distinct rows and counts routed to
+    // it from every worker, in chunk order so the first occurrence is kept.
+    // A worker's table is released once every partition has merged from it.
+    std::vector<std::atomic<size_t>> pending(workers);
+    for (auto& p : pending) {
+        p = rows.count();
+    }
+
+    runParallel(workers, [&](size_t w) {
+        for (size_t p = w; p < rows.count(); p += workers) {
+            size_t routed = 0;
+            for (size_t s = 0; s < workers; ++s) {
+                routed += routes[s][p].size();
+            }
+            rows[p].reserve(routed, 0);
+
+            for (size_t s = 0; s < workers; ++s) {
+                const RowTable& table = *local[s];
+                for (RowStore::RowId id : routes[s][p]) {
+                    rows[p].insertFrom(table.store(), id, table.count(id));
+                }
+                std::vector<RowStore::RowId>().swap(routes[s][p]);
+                if (--pending[s] == 0) {
+                    local[s].reset();
+                }
+            }
+        }
+    });
+
+    size_t count = 0;
+    for (size_t c : counts) {
+        count += c;
+    }
+    return count;
+}
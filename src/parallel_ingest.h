@@ -0,0 +1,24 @@
+#pragma once
+
+#include "row_store.h"
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+// Multi-threaded CSV ingest over an in-memory (mapped) buffer.
+// The buffer is cut into one byte range per worker. The quote parity at each
+// cut comes from a parallel quote count, so cuts snap to real record
+// boundaries even inside multi-line quoted fields. Workers deduplicate their
+// range into a private RowTable, so a repeated row is only counted; a second
+// parallel phase merges each partition's distinct rows and counts from every
+// worker, so no table is ever shared between threads.
+class ParallelCSVIngest {
+public:
+    // chunks + 1 ascending offsets from 0 to data.size(); every inner offset
+    // is the start of a record
+    static std::vector<size_t> chunkBoundaries(std::string_view data, size_t chunks);
+
+    // Parses data on one worker per partition of `rows`.
+    // Returns the number of rows ingested (duplicates included).
+    static size_t ingest(std::string_view data, RowPartitions& rows);
+};
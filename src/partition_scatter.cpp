@@ -0,0 +1,67 @@
+#include "partition_scatter.h"
+#include <algorithm>
+#include <filesystem>
+
+PartitionScatter::PartitionScatter(SpillDirectory& spill, size_t partitions, size_t budgetBytes, bool compress,
+                                   const CellKey::Policy& policy)
+    : spill_(spill)
+    , compress_(compress)
+    , fingerprint_(RowFingerprint::function(policy))
+    , capacity_(std::max<size_t>(budgetBytes / sizeof(SortEntry), 1))
+    , buffers_(std::max<size_t>(partitions, 1))
+    , files_(buffers_.size()) {
+}
+
+void PartitionScatter::reserve(size_t rows) {
+    size_t perPartition = std::min(rows, capacity_) / buffers_.size();
+    for (auto& buffer : buffers_) {
+        buffer.reserve(perPartition + perPartition / 8);
+    }
+}
+
+void PartitionScatter::add(const std::vector<std::string_view>& cells, uint64_t locator) {
+    if (buffered_ == capacity_) {
+        spill();
+    }
+    SortEntry entry{ fingerprint_(cells), locator };
+    buffers_[partitionOf(entry.fingerprint)].push_back(entry);
+    ++buffered_;
+}
+
+void PartitionScatter::spill() {
+    for (size_t p = 0; p < buffers_.size(); ++p) {
+        if (buffers_[p].empty()) {
+            continue;
+        }
+
+        bool append = !files_[p].empty();
+        if (!append) {
+            files_[p] = spill_.newFile();
+        }
+        RunWriter writer(files_[p], compress_, append);
+        for (const auto& entry : buffers_[p]) {
+            writer.write(entry);
+        }
+        writer.close();
+
+        // Keep the capacity: the next round fills about as much
+        buffers_[p].clear();
+    }
+    buffered_ = 0;
+}
+
+void PartitionScatter::load(size_t p, FingerprintIndex& index) {
+    if (!files_[p].empty()) {
+        RunReader reader(files_[p]);
+        SortEntry entry;
+        while (reader.next(entry)) {
+            index.add(entry);
+        }
+        std::filesystem::remove(files_[p]);
+    }
+
+    for (const auto& entry : buffers_[p]) {
+        index.add(entry);
+    }
+    buffers_[p] = std::vector<SortEntry>();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "external_sort.h"
+#include "fingerprint_index.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// First pass of a grace-hash comparison: scatters one input's
+// (fingerprint, locator) entries into hash partitions. Partitions stay in
+// memory until the side's budget is used up; then every buffered partition
+// is appended to its own spill file. Equal rows always land in the same
+// partition, so partition pairs of two inputs diff independently.
+class PartitionScatter {
+public:
+    // Rows are fingerprinted under `policy`
+    PartitionScatter(SpillDirectory& spill, size_t partitions, size_t budgetBytes, bool compress,
+                     const CellKey::Policy& policy);
+
+    // Sink interface shared with FingerprintIndex
+    void reserve(size_t rows);
+    void add(const std::vector<std::string_view>& cells, uint64_t locator);
+
+    size_t partitions() const { return buffers_.size(); }
+    size_t partitionOf(const RowFingerprint& fingerprint) const { return fingerprint.hi % buffers_.size(); }
+
+    // Moves partition p (spilled entries, then buffered ones) into `index`.
+    // Each partition can be loaded once; distinct partitions may be loaded
+    // from different threads.
+    void load(size_t p, FingerprintIndex& index);
+
+private:
+    void spill();
+
+    SpillDirectory& spill_;
+    bool compress_;
+    RowFingerprint::Function fingerprint_;
+    size_t capacity_;   // buffered entries across all partitions
+    size_t buffered_ = 0;
+    std::vector<std::vector<SortEntry>> buffers_;
+    std::vector<std::string> files_;  // spill file per partition, empty until first spill
+};
@@ -1,21 +1,26 @@
 #pragma once
 
+#include "cell_key.h"
 #include <vector>
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <cmath>
 #include <sstream>
 #include <iomanip>
 
+// Row equality and Row::Hash follow the default comparison policy
 struct Row {
     std::vector<std::string> columns;
 
     bool operator==(const Row& other) const;
-    static bool compareValues(std::string_view v1, std::string_view v2);
+    static bool compareValues(std::string_view v1, std::string_view v2,
+        const CellKey::Policy& policy = CellKey::defaults());
 
     struct Hash {
         size_t operator()(const Row& row) const;
-    private:
-        static std::string normalizeForHash(std::string_view value);
+
+        // Folds one cell into a running row hash
+        static uint64_t combine(uint64_t hash, std::string_view value);
     };
 };
\ No newline at end of file
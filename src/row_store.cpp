@@ -0,0 +1,363 @@
+#include "row_store.h"
+#include "cell_key_policy.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+RowStore::RowStore(const CellKey::Policy& policy, std::shared_ptr<const ColumnSchema> schema)
+    : policy_(&policy)
+    , keyCells_(visitPolicy(policy, []<typename P>(P) { return &RowStore::keyCells<P>; }))
+    , equalArenaCells_(visitPolicy(policy, []<typename P>(P) { return &RowStore::equalArenaCells<P>; }))
+    , schema_(schema && schema->packedCount() > 0 ? std::move(schema) : nullptr) {
+    if (schema_ && &schema_->policy() != policy_) {
+        throw std::runtime_error("Column schema was inferred under another comparison policy");
+    }
+    if (schema_) {
+        dictionaryCaches_.resize(schema_->width());
+    }
+    cellOffsets_.push_back(0);
+    rowOffsets_.push_back(0);
+    packedOffsets_.push_back(0);
+}
+
+RowStore::RowId RowStore::append(const std::vector<std::string_view>& cells) {
+    if (size() >= std::numeric_limits<RowId>::max()) {
+        throw std::runtime_error("Row store exceeds 32-bit row id range");
+    }
+
+    uint64_t hash = keyCells_(cells, keys_);
+
+    // Packed cells first; a row with any nonconforming one is stored as text
+    bool packed = schema_ && cells.size() == schema_->width();
+    if (packed) {
+        for (size_t i = 0; i < cells.size() && packed; ++i) {
+            if (!schema_->packed(i)) continue;
+            int64_t value;
+            packed = schema_->pack(i, cells[i], keys_[i], value, dictionaryCaches_[i]);
+            packed_.push_back(value);
+        }
+        if (!packed) {
+            packed_.resize(packedOffsets_.back());
+        }
+    }
+
+    for (size_t i = 0; i < cells.size(); ++i) {
+        if (packed && schema_->packed(i)) continue;
+        bytes_.insert(bytes_.end(), cells[i].begin(), cells[i].end());
+        cellOffsets_.push_back(bytes_.size());
+        cellKinds_.push_back(keys_[i].kind);
+        cellValues_.push_back(keys_[i].value);
+    }
+    rowOffsets_.push_back(cellOffsets_.size() - 1);
+    packedOffsets_.push_back(packed_.size());
+    rowHashes_.push_back(hash);
+    packedRows_ += packed ? 1 : 0;
+
+    return static_cast<RowId>(size() - 1);
+}
+
+RowStore::RowId RowStore::appendFrom(const RowStore& other, RowId id) {
+    if (other.schema_ != schema_ || other.policy_ != policy_) {
+        // Different layouts or keys: restate the row as text and store it afresh
+        std::vector<std::string> texts(other.cellCount(id));
+        std::vector<std::string_view> cells(texts.size());
+        char buffer[ColumnSchema::MAX_TEXT];
+        for (size_t i = 0; i < texts.size(); ++i) {
+            texts[i] = other.cell(id, i, buffer);
+            cells[i] = texts[i];
+        }
+        return append(cells);
+    }
+
+    if (size() >= std::numeric_limits<RowId>::max()) {
+        throw std::runtime_error("Row store exceeds 32-bit row id range");
+    }
+
+    // Bulk copy: keys and hash were computed when the row entered `other`
+    uint64_t first = other.rowOffsets_[id];
+    uint64_t last = other.rowOffsets_[id + 1];
+    uint64_t begin = other.cellOffsets_[first];
+    uint64_t base = bytes_.size();
+
+    bytes_.insert(bytes_.end(), other.bytes_.begin() + begin, other.bytes_.begin() + other.cellOffsets_[last]);
+    for (uint64_t k = first; k < last; ++k) {
+        cellOffsets_.push_back(other.cellOffsets_[k + 1] - begin + base);
+    }
+    cellKinds_.insert(cellKinds_.end(), other.cellKinds_.begin() + first, other.cellKinds_.begin() + last);
+    cellValues_.insert(cellValues_.end(), other.cellValues_.begin() + first, other.cellValues_.begin() + last);
+    packed_.insert(packed_.end(), other.packed_.begin() + other.packedOffsets_[id],
+                   other.packed_.begin() + other.packedOffsets_[id + 1]);
+    rowOffsets_.push_back(cellOffsets_.size() - 1);
+    packedOffsets_.push_back(packed_.size());
+    rowHashes_.push_back(other.rowHashes_[id]);
+    packedRows_ += other.isPacked(id) ? 1 : 0;
+
+    return static_cast<RowId>(size() - 1);
+}
+
+void RowStore::popBack() {
+    packedRows_ -= isPacked(static_cast<RowId>(size() - 1)) ? 1 : 0;
+    rowOffsets_.pop_back();
+    packedOffsets_.pop_back();
+    rowHashes_.pop_back();
+    cellOffsets_.resize(rowOffsets_.back() + 1);
+    cellKinds_.resize(rowOffsets_.back());
+    cellValues_.resize(rowOffsets_.back());
+    packed_.resize(packedOffsets_.back());
+    bytes_.resize(cellOffsets_.back());
+}
+
+void RowStore::reserve(size_t rows, size_t bytes) {
+    rowOffsets_.reserve(rows + 1);
+    rowHashes_.reserve(rows);
+    bytes_.reserve(bytes);
+    if (schema_) {
+        packedOffsets_.reserve(rows + 1);
+        packed_.reserve(rows * schema_->packedCount());
+    }
+}
+
+size_t RowStore::cellCount(RowId id) const {
+    size_t count = rowOffsets_[id + 1] - rowOffsets_[id];
+    return isPacked(id) ? count + schema_->packedCount() : count;
+}
+
+std::string_view RowStore::text(RowId id, size_t k) const {
+    k += rowOffsets_[id];
+    return std::string_view(bytes_.data() + cellOffsets_[k], cellOffsets_[k + 1] - cellOffsets_[k]);
+}
+
+std::string_view RowStore::cell(RowId id, size_t column, char* buffer) const {
+    if (!isPacked(id)) {
+        return text(id, column);
+    }
+    size_t slot = schema_->slot(column);
+    if (schema_->packed(column)) {
+        return schema_->unpack(column, packed_[packedOffsets_[id] + slot], buffer);
+    }
+    return text(id, slot);
+}
+
+CellKey RowStore::key(RowId id, size_t column) const {
+    if (isPacked(id)) {
+        size_t slot = schema_->slot(column);
+        if (schema_->packed(column)) {
+            return schema_->key(column, packed_[packedOffsets_[id] + slot]);
+        }
+        column = slot;
+    }
+    size_t k = rowOffsets_[id] + column;
+    return CellKey{ cellKinds_[k], cellValues_[k] };
+}
+
+bool RowStore::equals(RowId id, const RowStore& other, RowId otherId) const {
+    if (hash(id) != other.hash(otherId)) return false;
+
+    bool packed = isPacked(id);
+    if (packed != other.isPacked(otherId) || (packed && schema_ != other.schema_)) {
+        return equalCells(id, other, otherId);
+    }
+
+    if (packed) {
+        //   OPTIMIZED: All packed cells of the row compare as one block
+        size_t count = schema_->packedCount();
+        if (std::memcmp(packed_.data() + packedOffsets_[id],
+                        other.packed_.data() + other.packedOffsets_[otherId], count * sizeof(int64_t)) != 0) {
+            return false;
+        }
+    }
+
+    // Arena cells
+    return (this->*equalArenaCells_)(id, other, otherId);
+}
+
+template <typename P>
+uint64_t RowStore::keyCells(const std::vector<std::string_view>& cells, std::vector<CellKey>& keys) {
+    uint64_t hash = 0;
+    keys.clear();
+    for (const auto& cell : cells) {
+        keys.push_back(P::make(cell));
+        hash = P::hash(hash, keys.back(), cell);
+    }
+    return hash;
+}
+
+template <typename P>
+bool RowStore::equalArenaCells(RowId id, const RowStore& other, RowId otherId) const {
+    size_t count = rowOffsets_[id + 1] - rowOffsets_[id];
+    if (count != other.rowOffsets_[otherId + 1] - other.rowOffsets_[otherId]) return false;
+
+    size_t k = rowOffsets_[id];
+    size_t otherK = other.rowOffsets_[otherId];
+    for (size_t i = 0; i < count; ++i, ++k, ++otherK) {
+        if (cellKinds_[k] != other.cellKinds_[otherK]) return false;
+
+        if (cellKinds_[k] == CellKey::Kind::String) {
+            if (!P::equalText(text(id, i), other.text(otherId, i))) return false;
+        }
+        else if (cellValues_[k] != other.cellValues_[otherK]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RowStore::equalCells(RowId id, const RowStore& other, RowId otherId) const {
+    size_t count = cellCount(id);
+    if (count != other.cellCount(otherId)) return false;
+
+    char buffer[ColumnSchema::MAX_TEXT];
+    char otherBuffer[ColumnSchema::MAX_TEXT];
+    for (size_t i = 0; i < count; ++i) {
+        if (!policy_->equal(key(id, i), cell(id, i, buffer),
+                            other.key(otherId, i), other.cell(otherId, i, otherBuffer))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Row RowStore::materialize(RowId id) const {
+    Row row;
+    size_t count = cellCount(id);
+    row.columns.reserve(count);
+    char buffer[ColumnSchema::MAX_TEXT];
+    for (size_t i = 0; i < count; ++i) {
+        row.columns.emplace_back(cell(id, i, buffer));
+    }
+    return row;
+}
+
+RowTable::RowTable(const CellKey::Policy& policy, std::shared_ptr<const ColumnSchema> schema)
+    : store_(policy, std::move(schema)), ids_(&store_) {
+}
+
+bool RowTable::insert(const std::vector<std::string_view>& cells) {
+    auto [id, inserted] = ids_.insert(store_.append(cells));
+    if (!inserted) {
+        // Duplicate row: give the arena space back
+        store_.popBack();
+        countDuplicate(id);
+        return false;
+    }
+    counts_.push_back(1);
+    return true;
+}
+
+bool RowTable::insertFrom(const RowStore& store, RowStore::RowId id, uint32_t occurrences) {
+    RowStore::RowId existing = find(store, id);
+    if (existing != NOT_FOUND) {
+        countDuplicate(existing, occurrences);
+        return false;
+    }
+    ids_.insert(store_.appendFrom(store, id));
+    counts_.push_back(occurrences);
+    return true;
+}
+
+void RowTable::countDuplicate(RowStore::RowId id, uint32_t occurrences) {
+    if (counts_[id] > std::numeric_limits<uint32_t>::max() - occurrences) {
+        throw std::runtime_error("Row occurrence count exceeds 32-bit range");
+    }
+    counts_[id] += occurrences;
+}
+
+bool RowTable::contains(const RowStore& store, RowStore::RowId id) const {
+    return ids_.contains(store, id);
+}
+
+void RowTable::reserve(size_t rows, size_t bytes) {
+    store_.reserve(rows, bytes);
+    counts_.reserve(rows);
+    ids_.reserve(rows);
+}
+
+RowPartitions::RowPartitions(size_t count, const CellKey::Policy& policy, std::shared_ptr<const ColumnSchema> schema)
+    : policy_(&policy)
+    , schema_(std::move(schema))
+    , staging_(policy, schema_) {
+    for (size_t i = 0; i < std::max<size_t>(count, 1); ++i) {
+        tables_.emplace_back(policy, schema_);
+    }
+}
+
+bool RowPartitions::insert(const std::vector<std::string_view>& cells) {
+    if (tables_.size() == 1) {
+        return tables_[0].insert(cells);
+    }
+    RowStore::RowId staged = staging_.append(cells);
+    bool inserted;
+    try {
+        inserted = tables_[partitionOf(staging_.hash(staged))].insertFrom(staging_, staged);
+    }
+    catch (...) {
+        staging_.popBack();
+        throw;
+    }
+    staging_.popBack();
+    return inserted;
+}
+
+void RowPartitions::reserve(size_t rows, size_t bytes) {
+    for (auto& table : tables_) {
+        table.reserve(rows / tables_.size() + 1, bytes / tables_.size());
+    }
+}
+
+size_t RowPartitions::size() const {
+    size_t total = 0;
+    for (const auto& table : tables_) {
+        total += table.size();
+    }
+    return total;
+}
+
+ShardedRowTable::ShardedRowTable(const CellKey::Policy& policy) {
+    for (size_t i = 0; i < SHARDS; ++i) {
+        shards_.emplace_back(policy);
+    }
+}
+
+bool ShardedRowTable::insert(const std::vector<std::string_view>& cells, RowStore& staging) {
+    // Cell keys and the row hash are computed here, outside the lock
+    RowStore::RowId staged = staging.append(cells);
+    Shard& shard = shards_[shardOf(staging.hash(staged))];
+
+    while (shard.busy.test_and_set(std::memory_order_acquire)) {
+        // Spin on a plain load so waiters do not bounce the line; yield in
+        // case the holder was preempted
+        while (shard.busy.test(std::memory_order_relaxed)) {
+            std::this_thread::yield();
+        }
+    }
+
+    bool inserted;
+    try {
+        inserted = shard.table.insertFrom(staging, staged);
+    }
+    catch (...) {
+        shard.busy.clear(std::memory_order_release);
+        staging.popBack();
+        throw;
+    }
+    shard.busy.clear(std::memory_order_release);
+
+    staging.popBack();
+    return inserted;
+}
+
+void ShardedRowTable::reserve(size_t rows, size_t bytes) {
+    for (size_t i = 0; i < SHARDS; ++i) {
+        shards_[i].table.reserve(rows / SHARDS + 1, bytes / SHARDS);
+    }
+}
+
+size_t ShardedRowTable::size() const {
+    size_t total = 0;
+    for (size_t i = 0; i < SHARDS; ++i) {
+        total += shards_[i].table.size();
+    }
+    return total;
+}
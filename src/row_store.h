@@ -0,0 +1,201 @@
+#pragma once
+
+#include "row.h"
+#include "column_schema.h"
+#include "flat_id_set.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Packs the cells of many rows into one contiguous byte arena.
+// Rows are addressed by 32-bit ids; cell boundaries live in a flat offsets
+// array, so a row costs two offsets per cell instead of one heap string.
+// Each cell's CellKey and each row's hash are computed once at append, so
+// probes only do integer compares and memcmp.
+//
+// Keys, hashes and equality follow the store's CellKey::Policy; stores
+// compared with each other must share it.
+//
+// With a ColumnSchema, rows of the schema's width whose packed columns all
+// conform store those cells as one int64 each in a per-row block, and only
+// the remaining cells in the arena. Such rows compare with rows of a store
+// sharing the schema by one memcmp over the block; any other pairing falls
+// back to comparing cell keys.
+class RowStore {
+public:
+    using RowId = uint32_t;
+
+    // A schema must have been inferred under `policy`
+    explicit RowStore(const CellKey::Policy& policy = CellKey::defaults(),
+                      std::shared_ptr<const ColumnSchema> schema = nullptr);
+
+    RowId append(const std::vector<std::string_view>& cells);
+    RowId appendFrom(const RowStore& other, RowId id);
+    void popBack();
+    void reserve(size_t rows, size_t bytes);
+
+    size_t size() const { return rowHashes_.size(); }
+    size_t cellCount(RowId id) const;
+    size_t hash(RowId id) const { return rowHashes_[id]; }
+    bool equals(RowId id, const RowStore& other, RowId otherId) const;
+    Row materialize(RowId id) const;
+
+    // Rows stored with packed cells
+    size_t packedRows() const { return packedRows_; }
+    const std::shared_ptr<const ColumnSchema>& schema() const { return schema_; }
+    const CellKey::Policy& policy() const { return *policy_; }
+
+private:
+    bool isPacked(RowId id) const { return packedOffsets_[id + 1] != packedOffsets_[id]; }
+
+    // k-th arena cell of a row
+    std::string_view text(RowId id, size_t k) const;
+
+    // Text and key of any column, whichever way the row is stored; packed
+    // cells are rendered into `buffer` (ColumnSchema::MAX_TEXT bytes)
+    std::string_view cell(RowId id, size_t column, char* buffer) const;
+    CellKey key(RowId id, size_t column) const;
+
+    bool equalCells(RowId id, const RowStore& other, RowId otherId) const;
+
+    // Per-cell loops specialised on the policy's ComparePolicy type; the
+    // constructor picks the instantiation, so rows pay one indirect call
+    // and cells none
+    template <typename P>
+    static uint64_t keyCells(const std::vector<std::string_view>& cells, std::vector<CellKey>& keys);
+    template <typename P>
+    bool equalArenaCells(RowId id, const RowStore& other, RowId otherId) const;
+
+    const CellKey::Policy* policy_;
+    uint64_t (*keyCells_)(const std::vector<std::string_view>& cells, std::vector<CellKey>& keys);
+    bool (RowStore::*equalArenaCells_)(RowId id, const RowStore& other, RowId otherId) const;
+    std::shared_ptr<const ColumnSchema> schema_;  // null, or with packed columns
+    std::vector<char> bytes_;
+    std::vector<uint64_t> cellOffsets_;  // cell k spans [cellOffsets_[k], cellOffsets_[k + 1])
+    std::vector<CellKey::Kind> cellKinds_;
+    std::vector<int64_t> cellValues_;    // CellKey::value, parallel to cellKinds_
+    std::vector<uint64_t> rowOffsets_;   // row r owns arena cells [rowOffsets_[r], rowOffsets_[r + 1])
+    std::vector<uint64_t> rowHashes_;    // computed once at append
+    std::vector<int64_t> packed_;        // packed cells of packed rows, schema's packed columns in order
+    std::vector<uint64_t> packedOffsets_;  // row r owns packed_[packedOffsets_[r], packedOffsets_[r + 1])
+    std::vector<CellKey> keys_;          // append() scratch
+    std::vector<StringDictionary::Cache> dictionaryCaches_;  // by column; a store is filled by one thread
+    size_t packedRows_ = 0;
+};
+
+// The distinct rows of one input: cells live in the store, the flat set only
+// holds row ids. Every distinct row also carries its occurrence count in a
+// 4-byte counter, bumped when a duplicate is folded in during ingest.
+// Not movable, since the set points at the store.
+class RowTable {
+public:
+    explicit RowTable(const CellKey::Policy& policy = CellKey::defaults(),
+                      std::shared_ptr<const ColumnSchema> schema = nullptr);
+    RowTable(const RowTable&) = delete;
+    RowTable& operator=(const RowTable&) = delete;
+
+    using IdSet = FlatIdSet<RowStore>;
+    static constexpr RowStore::RowId NOT_FOUND = IdSet::NONE;
+
+    // Inserts a row unless an equal one is already present, in which case
+    // that row's count goes up instead
+    bool insert(const std::vector<std::string_view>& cells);
+    // `occurrences` is how often the row was seen, e.g. when merging the
+    // counts of another table
+    bool insertFrom(const RowStore& store, RowStore::RowId id, uint32_t occurrences = 1);
+
+    // Id of the row equal to `store`'s row `id`, or NOT_FOUND
+    RowStore::RowId find(const RowStore& store, RowStore::RowId id) const { return ids_.find(store, id); }
+    bool contains(const RowStore& store, RowStore::RowId id) const;
+    void reserve(size_t rows, size_t bytes);
+
+    size_t size() const { return ids_.size(); }
+    uint32_t count(RowStore::RowId id) const { return counts_[id]; }
+    const RowStore& store() const { return store_; }
+    const IdSet& index() const { return ids_; }
+
+    IdSet::const_iterator begin() const { return ids_.begin(); }
+    IdSet::const_iterator end() const { return ids_.end(); }
+
+private:
+    void countDuplicate(RowStore::RowId id, uint32_t occurrences = 1);
+
+    RowStore store_;
+    IdSet ids_;
+    std::vector<uint32_t> counts_;  // occurrences, indexed by row id
+};
+
+// The distinct rows of one input split by hash into independent RowTables,
+// so different threads can fill and probe different partitions. A row can
+// only ever be found in partition partitionOf(hash).
+class RowPartitions {
+public:
+    RowPartitions(size_t count, const CellKey::Policy& policy,
+                  std::shared_ptr<const ColumnSchema> schema = nullptr);
+
+    size_t count() const { return tables_.size(); }
+    size_t partitionOf(uint64_t hash) const { return static_cast<size_t>((hash >> 32) % tables_.size()); }
+
+    RowTable& operator[](size_t partition) { return tables_[partition]; }
+    const RowTable& operator[](size_t partition) const { return tables_[partition]; }
+
+    // Inserts into the owning partition unless an equal row is present. The
+    // row is keyed and hashed once, into a staging store, and copied from there
+    bool insert(const std::vector<std::string_view>& cells);
+
+    // Spreads a whole-input estimate evenly over the partitions
+    void reserve(size_t rows, size_t bytes);
+
+    // Distinct rows over all partitions
+    size_t size() const;
+
+    // Policy and schema every partition's store was created with
+    const CellKey::Policy& policy() const { return *policy_; }
+    const std::shared_ptr<const ColumnSchema>& schema() const { return schema_; }
+
+private:
+    const CellKey::Policy* policy_;
+    std::shared_ptr<const ColumnSchema> schema_;
+    std::deque<RowTable> tables_;
+    RowStore staging_;  // holds the row being inserted, routed by its hash
+};
+
+// The distinct rows of one input, filled by many threads at once. Rows are
+// sharded on the top bits of their hash (the flat sets index with the low
+// bits) and every shard is a RowTable behind its own spinlock, padded to a
+// cache line so neighbouring locks never share one. Callers key and hash a
+// row into their own staging store before any lock is taken, so the critical
+// section is just a probe plus an arena copy.
+class ShardedRowTable {
+public:
+    static constexpr unsigned SHARD_BITS = 6;
+    static constexpr size_t SHARDS = size_t(1) << SHARD_BITS;
+
+    explicit ShardedRowTable(const CellKey::Policy& policy = CellKey::defaults());
+
+    static size_t shardOf(uint64_t hash) { return static_cast<size_t>(hash >> (64 - SHARD_BITS)); }
+
+    // Thread-safe. `staging` is per-thread scratch and is left empty.
+    bool insert(const std::vector<std::string_view>& cells, RowStore& staging);
+
+    // Spreads a whole-input estimate evenly over the shards; not thread-safe
+    void reserve(size_t rows, size_t bytes);
+
+    // Not thread-safe; call once all inserts are done
+    RowTable& shard(size_t index) { return shards_[index].table; }
+    const RowTable& shard(size_t index) const { return shards_[index].table; }
+    size_t size() const;
+
+private:
+    struct alignas(64) Shard {
+        explicit Shard(const CellKey::Policy& policy) : table(policy) {}
+
+        std::atomic_flag busy;
+        RowTable table;
+    };
+
+    std::deque<Shard> shards_;
+};
@@ -0,0 +1,199 @@
+#include "run_stats.h"
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+std::string jsonString(std::string_view value) {
+    std::string out = "\"";
+    for (char c : value) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                out += escaped;
+            }
+            else {
+                out += c;
+            }
+        }
+    }
+    return out + "\"";
+}
+
+std::string jsonNumber(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.6g", value);
+    return buffer;
+}
+
+double perSecond(uint64_t amount, double seconds) {
+    return seconds > 0 ? static_cast<double>(amount) / seconds : 0.0;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+// ============ SCOPE ============
+
+RunStats::Scope::Scope(RunStats& stats, std::string_view name, size_t threads)
+    : stats_(stats)
+    , name_(name)
+    , threads_(std::max<size_t>(threads, 1))
+    , wallStart_(std::chrono::steady_clock::now())
+    , cpuStart_(processCpuSeconds()) {
+}
+
+RunStats::Scope::~Scope() {
+    Stage& stage = stats_.stage(name_);
+    stage.wallSeconds += secondsSince(wallStart_);
+    stage.cpuSeconds += processCpuSeconds() - cpuStart_;
+    stage.bytes += bytes_;
+    stage.rows += rows_;
+    stage.threads = std::max(stage.threads, threads_);
+}
+
+// ============ RUN STATS ============
+
+RunStats::RunStats()
+    : wallStart_(std::chrono::steady_clock::now())
+    , cpuStart_(processCpuSeconds()) {
+}
+
+RunStats::Stage& RunStats::stage(std::string_view name) {
+    auto it = std::find_if(stages_.begin(), stages_.end(), [name](const Stage& s) { return s.name == name; });
+    if (it != stages_.end()) {
+        return *it;
+    }
+    stages_.push_back(Stage{ std::string(name) });
+    return stages_.back();
+}
+
+void RunStats::addHashTable(uint64_t entries, uint64_t slots, uint64_t lookups, uint64_t groupProbes) {
+    ++hashTables_.tables;
+    hashTables_.entries += entries;
+    hashTables_.slots += slots;
+    hashTables_.lookups += lookups;
+    hashTables_.groupProbes += groupProbes;
+}
+
+void RunStats::setField(const std::string& key, const std::string& value) {
+    fields_.emplace_back(key, jsonString(value));
+}
+
+void RunStats::setField(const std::string& key, uint64_t value) {
+    fields_.emplace_back(key, std::to_string(value));
+}
+
+void RunStats::setField(const std::string& key, bool value) {
+    fields_.emplace_back(key, value ? "true" : "false");
+}
+
+std::string RunStats::toJson() const {
+    std::ostringstream out;
+    out << "{\n";
+    for (const auto& [key, value] : fields_) {
+        out << "  " << jsonString(key) << ": " << value << ",\n";
+    }
+    out << "  \"wall_seconds\": " << jsonNumber(secondsSince(wallStart_)) << ",\n";
+    out << "  \"cpu_seconds\": " << jsonNumber(processCpuSeconds() - cpuStart_) << ",\n";
+    out << "  \"peak_rss_bytes\": " << peakRssBytes() << ",\n";
+
+    out << "  \"stages\": [";
+    for (size_t i = 0; i < stages_.size(); ++i) {
+        const Stage& stage = stages_[i];
+        // CPU time over the wall time of every thread the stage could use
+        double utilization = stage.wallSeconds > 0
+            ? stage.cpuSeconds / (stage.wallSeconds * static_cast<double>(stage.threads)) : 0.0;
+
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    { \"name\": " << jsonString(stage.name)
+            << ", \"wall_seconds\": " << jsonNumber(stage.wallSeconds)
+            << ", \"cpu_seconds\": " << jsonNumber(stage.cpuSeconds)
+            << ", \"threads\": " << stage.threads
+            << ", \"thread_utilization\": " << jsonNumber(utilization)
+            << ", \"bytes\": " << stage.bytes
+            << ", \"rows\": " << stage.rows
+            << ", \"bytes_per_second\": " << jsonNumber(perSecond(stage.bytes, stage.wallSeconds))
+            << ", \"rows_per_second\": " << jsonNumber(perSecond(stage.rows, stage.wallSeconds))
+            << " }";
+    }
+    out << (stages_.empty() ? "]" : "\n  ]");
+
+    if (hashTables_.tables > 0) {
+        const HashTables& tables = hashTables_;
+        out << ",\n  \"hash_tables\": { \"tables\": " << tables.tables
+            << ", \"entries\": " << tables.entries
+            << ", \"slots\": " << tables.slots
+            << ", \"load_factor\": " << jsonNumber(tables.slots > 0
+                ? static_cast<double>(tables.entries) / static_cast<double>(tables.slots) : 0.0)
+            << ", \"lookups\": " << tables.lookups
+            << ", \"group_probes\": " << tables.groupProbes
+            << ", \"probes_per_lookup\": " << jsonNumber(tables.lookups > 0
+                ? static_cast<double>(tables.groupProbes) / static_cast<double>(tables.lookups) : 0.0)
+            << " }";
+    }
+
+    out << "\n}\n";
+    return out.str();
+}
+
+double RunStats::processCpuSeconds() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return 0.0;
+    }
+    auto seconds = [](const FILETIME& time) {
+        ULARGE_INTEGER ticks;
+        ticks.LowPart = time.dwLowDateTime;
+        ticks.HighPart = time.dwHighDateTime;
+        return static_cast<double>(ticks.QuadPart) * 1e-7;  // 100 ns ticks
+    };
+    return seconds(kernel) + seconds(user);
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    auto seconds = [](const timeval& time) {
+        return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_usec) * 1e-6;
+    };
+    return seconds(usage.ru_utime) + seconds(usage.ru_stime);
+#endif
+}
+
+uint64_t RunStats::peakRssBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return static_cast<uint64_t>(counters.PeakWorkingSetSize);
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);         // bytes
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;  // KiB
+#endif
+#endif
+}
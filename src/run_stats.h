@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Per-stage timings and counters of one comparison, for a machine-readable
+// report (--stats=json) when the build has no Tracy. Stages are recorded
+// with a Scope; a stage entered twice accumulates.
+class RunStats {
+public:
+    struct Stage {
+        std::string name;
+        double wallSeconds = 0;
+        double cpuSeconds = 0;   // whole process, so all threads count
+        uint64_t bytes = 0;
+        uint64_t rows = 0;
+        size_t threads = 1;
+    };
+
+    // Hash tables of the in-memory and keyed engines, summed over tables
+    struct HashTables {
+        size_t tables = 0;
+        uint64_t entries = 0;
+        uint64_t slots = 0;
+        uint64_t lookups = 0;      // inserts included
+        uint64_t groupProbes = 0;  // 16-slot control groups visited
+    };
+
+    class Scope {
+    public:
+        Scope(RunStats& stats, std::string_view name, size_t threads = 1);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        void addBytes(uint64_t bytes) { bytes_ += bytes; }
+        void addRows(uint64_t rows) { rows_ += rows; }
+
+    private:
+        RunStats& stats_;
+        std::string name_;
+        size_t threads_;
+        uint64_t bytes_ = 0;
+        uint64_t rows_ = 0;
+        std::chrono::steady_clock::time_point wallStart_;
+        double cpuStart_;
+    };
+
+    RunStats();
+
+    void addHashTable(uint64_t entries, uint64_t slots, uint64_t lookups, uint64_t groupProbes);
+
+    // Top-level report fields
+    void setField(const std::string& key, const std::string& value);
+    void setField(const std::string& key, uint64_t value);
+    void setField(const std::string& key, bool value);
+
+    const std::vector<Stage>& stages() const { return stages_; }
+    const HashTables& hashTables() const { return hashTables_; }
+
+    // Report with totals up to now
+    std::string toJson() const;
+
+    // CPU time of all threads of the process so far
+    static double processCpuSeconds();
+
+    // High-water mark of the resident set
+    static uint64_t peakRssBytes();
+
+private:
+    Stage& stage(std::string_view name);
+
+    std::chrono::steady_clock::time_point wallStart_;
+    double cpuStart_;
+    std::vector<std::pair<std::string, std::string>> fields_;  // values JSON-encoded
+    std::vector<Stage> stages_;
+    HashTables hashTables_;
+};
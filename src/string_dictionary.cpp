@@ -0,0 +1,61 @@
+#include "string_dictionary.h"
+#include <mutex>
+#include <wyhash.h>
+
+StringDictionary::StringDictionary(size_t capacity, const CellKey::Policy& policy)
+    : capacity_(capacity)
+    , codes_(0, Hash{ &policy }, Equal{ &policy }) {
+}
+
+uint32_t StringDictionary::encode(std::string_view text) {
+    {
+        std::shared_lock lock(mutex_);
+        auto found = codes_.find(text);
+        if (found != codes_.end()) {
+            return values_[found->second] == text ? found->second : NONE;
+        }
+    }
+
+    std::unique_lock lock(mutex_);
+    auto found = codes_.find(text);
+    if (found != codes_.end()) {
+        // Another thread added the class in between
+        return values_[found->second] == text ? found->second : NONE;
+    }
+    if (values_.size() >= capacity_) {
+        return NONE;
+    }
+
+    uint32_t code = static_cast<uint32_t>(values_.size());
+    values_.emplace_back(text);
+    codes_.emplace(values_.back(), code);
+    return code;
+}
+
+std::string_view StringDictionary::decode(uint32_t code) const {
+    std::shared_lock lock(mutex_);
+    return values_[code];
+}
+
+size_t StringDictionary::size() const {
+    std::shared_lock lock(mutex_);
+    return values_.size();
+}
+
+uint32_t StringDictionary::Cache::encode(StringDictionary& dictionary, std::string_view text) {
+    if (slots_.empty()) {
+        slots_.resize(SLOTS);
+    }
+
+    //   OPTIMIZED: Exact-text hit answered from thread-local memory; only
+    //   misses reach the shared table and its lock
+    Slot& slot = slots_[wyhash(text.data(), text.size(), 0, _wyp) & (SLOTS - 1)];
+    if (slot.used && slot.text == text) {
+        return slot.code;
+    }
+
+    slot.code = dictionary.encode(text);
+    slot.text.assign(text);
+    slot.used = true;
+    return slot.code;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "cell_key.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Intern table of one low-cardinality text column, shared by every store
+// and thread of a comparison. Texts are grouped into classes of values the
+// dictionary's comparison policy considers equal ("USD" and "usd" when case is
+// folded); each class gets a 32-bit code and keeps its first text as
+// representative. Only a representative encodes, so decoding a code always
+// restores the exact text, and equal codes always mean equal cells.
+//
+// Lookups take a shared lock, and only a new class takes the exclusive one,
+// which for a low-cardinality column happens a handful of times per run.
+// Hot encoding goes through a per-thread Cache, which takes no lock at all
+// once a column's values have been seen.
+class StringDictionary {
+public:
+    static constexpr uint32_t NONE = ~uint32_t(0);
+
+    // One thread's front of a dictionary: a small direct-mapped table of
+    // exact texts and what they encoded to. A text's answer never changes
+    // (codes are permanent, and so is NONE for a non-representative or a
+    // full table), so a hit needs neither the lock nor the policy.
+    class Cache {
+    public:
+        uint32_t encode(StringDictionary& dictionary, std::string_view text);
+
+    private:
+        static constexpr size_t SLOTS = 256;
+
+        struct Slot {
+            std::string text;
+            uint32_t code = NONE;
+            bool used = false;
+        };
+        std::vector<Slot> slots_;  // allocated on first use
+    };
+
+    StringDictionary(size_t capacity, const CellKey::Policy& policy);
+    StringDictionary(const StringDictionary&) = delete;
+    StringDictionary& operator=(const StringDictionary&) = delete;
+
+    // Code of `text`, adding a class for it if there is room. NONE when the
+    // table is full or `text` is not its class's representative.
+    uint32_t encode(std::string_view text);
+
+    // Representative text of a code; valid as long as the dictionary
+    std::string_view decode(uint32_t code) const;
+
+    size_t size() const;
+
+private:
+    struct Hash {
+        const CellKey::Policy* policy;
+        size_t operator()(std::string_view text) const { return policy->hash(0, CellKey{}, text); }
+    };
+    struct Equal {
+        const CellKey::Policy* policy;
+        bool operator()(std::string_view a, std::string_view b) const { return policy->equalText(a, b); }
+    };
+
+    size_t capacity_;
+    mutable std::shared_mutex mutex_;
+    std::deque<std::string> values_;  // by code; elements never move
+    std::unordered_map<std::string_view, uint32_t, Hash, Equal> codes_;
+};
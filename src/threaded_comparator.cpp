@@ -1,54 +1,43 @@
 #include "threaded_comparator.h"
+#include "block_reader.h"
+#include "bounded_queue.h"
 #include "csv_parser.h"
+#include "csv_tokenizer.h"
+#include "mapped_file.h"
 #include <fstream>
 #include <iostream>
 #include <algorithm>
-#include <chrono>
 
 ThreadedCSVComparator::ThreadedCSVComparator() = default;
 ThreadedCSVComparator::~ThreadedCSVComparator() = default;
 
-size_t ThreadedCSVComparator::countRows(const std::string& filename) {
+size_t ThreadedCSVComparator::estimateRows(const std::string& filename) {
     ZoneScoped;
-    ZoneName("Count Rows", 10);
+    ZoneName("Estimate Rows", 13);
 
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        throw std::runtime_error("Could not open file: " + filename);
-    }
-
-    size_t count = 0;
-    std::string line;
-    while (std::getline(file, line)) {
-        if (!line.empty()) {
-            ++count;
-        }
-    }
+    // Sampled SIMD newline count over the mapping instead of a getline pass
+    MappedFile file(filename);
+    size_t estimate = CSVTokenizer::estimateRecords(file.data());
 
 #ifdef TRACY_ENABLE
-    TracyPlot("Row Count", static_cast<int64_t>(count));
+    TracyPlot("Row Estimate", static_cast<int64_t>(estimate));
 #endif
-    return count;
+    return estimate;
 }
 
-std::unordered_set<Row, Row::Hash> ThreadedCSVComparator::readCSV(const std::string& filename) {
+void ThreadedCSVComparator::readCSV(const std::string& filename, RowTable& rows) {
     ZoneScoped;
     ZoneName("Read CSV (Single-threaded)", 26);
 
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        throw std::runtime_error("Could not open file: " + filename);
-    }
+    //   OPTIMIZED: Memory-mapped input, fields are views into the mapping
+    MappedFile file(filename);
 
-    std::unordered_set<Row, Row::Hash> rows;
-    std::string line;
+    // Pre-size from a sampled newline count so the table never rehashes mid-read
+    rows.reserve(CSVTokenizer::estimateRecords(file.data()), file.size());
 
-    while (std::getline(file, line)) {
-        if (line.empty()) continue;
-        rows.insert(CSVParser::parseCSVRow(line));
-    }
-
-    return rows;
+    CSVParser::forEachRecord(file.data(), [&rows](const std::vector<std::string_view>& fields) {
+        rows.insert(fields);
+    });
 }
 
 void ThreadedCSVComparator::writeRowsToCSV(const std::string& filename, const std::vector<Row>& rows) {
@@ -92,10 +81,13 @@ ThreadedCSVComparator::compareSingleThreaded(const std::string& file1, const std
 
     ComparisonResult result;
 
+    RowTable rows1;
+    RowTable rows2;
+
     {
         ZoneScoped;
         ZoneName("Read File 1", 11);
-        auto rows1 = readCSV(file1);
+        readCSV(file1, rows1);
         result.file1RowCount = rows1.size();
 #ifdef TRACY_ENABLE
         TracyPlot("File 1 Rows", static_cast<int64_t>(rows1.size()));
@@ -105,28 +97,26 @@ ThreadedCSVComparator::compareSingleThreaded(const std::string& file1, const std
     {
         ZoneScoped;
         ZoneName("Read File 2", 11);
-        auto rows2 = readCSV(file2);
+        readCSV(file2, rows2);
         result.file2RowCount = rows2.size();
 #ifdef TRACY_ENABLE
         TracyPlot("File 2 Rows", static_cast<int64_t>(rows2.size()));
 #endif
+    }
 
-        {
-            ZoneScoped;
-            ZoneName("Find Differences", 16);
-
-            auto rows1Temp = readCSV(file1); // Re-read for comparison
+    {
+        ZoneScoped;
+        ZoneName("Find Differences", 16);
 
-            for (const auto& row : rows1Temp) {
-                if (rows2.find(row) == rows2.end()) {
-                    result.onlyInFile1.push_back(row);
-                }
+        for (RowStore::RowId id : rows1) {
+            if (!rows2.contains(rows1.store(), id)) {
+                result.onlyInFile1.push_back(rows1.store().materialize(id));
             }
+        }
 
-            for (const auto& row : rows2) {
-                if (rows1Temp.find(row) == rows1Temp.end()) {
-                    result.onlyInFile2.push_back(row);
-                }
+        for (RowStore::RowId id : rows2) {
+            if (!rows1.contains(rows2.store(), id)) {
+                result.onlyInFile2.push_back(rows2.store().materialize(id));
             }
         }
     }
@@ -139,10 +129,40 @@ ThreadedCSVComparator::compareSingleThreaded(const std::string& file1, const std
     return result;
 }
 
-void ThreadedCSVComparator::readerThread(const std::string& filename,
-    boost::lockfree::queue<std::string*>& queue,
-    std::atomic<bool>& complete,
-    std::atomic<bool>& errorFlag) {
+// Reader -> parser handoff. Filled batches of both inputs share one queue;
+// parsed ones go back to their input's free pool, which bounds memory and
+// blocks a reader that gets ahead of the parsers. Batches are owned here,
+// the queues only pass pointers around.
+struct ThreadedCSVComparator::Pipeline {
+    explicit Pipeline(size_t batchesPerInput)
+        : filled(2 * batchesPerInput)
+        , free1(batchesPerInput)
+        , free2(batchesPerInput) {
+        for (size_t i = 0; i < 2 * batchesPerInput; ++i) {
+            batches.push_back(std::make_unique<RecordBatch>());
+            (i % 2 == 0 ? free1 : free2).push(batches.back().get());
+        }
+    }
+
+    BoundedQueue<RecordBatch*>& freeFor(int file) { return file == 1 ? free1 : free2; }
+
+    // Unblocks every thread so the run can unwind
+    void fail() {
+        failed = true;
+        filled.close();
+        free1.close();
+        free2.close();
+    }
+
+    std::vector<std::unique_ptr<RecordBatch>> batches;
+    BoundedQueue<RecordBatch*> filled;
+    BoundedQueue<RecordBatch*> free1;
+    BoundedQueue<RecordBatch*> free2;
+    std::atomic<int> readersLeft{ 2 };
+    std::atomic<bool> failed{ false };
+};
+
+void ThreadedCSVComparator::readerThread(const std::string& filename, int file, Pipeline& pipeline) {
     ZoneScoped;
     ZoneName("Reader Thread", 13);
 
@@ -151,66 +171,59 @@ void ThreadedCSVComparator::readerThread(const std::string& filename,
 #endif
 
     try {
-        std::ifstream file(filename);
-        if (!file.is_open()) {
-            std::cerr << "Reader thread: Could not open file: " << filename << std::endl;
-            errorFlag = true;
-            complete = true;
-            return;
-        }
-
-        std::string line;
-        size_t linesRead = 0;
+        //   OPTIMIZED: Large aligned block reads kept in flight (io_uring when
+        //   available, pread otherwise), cut into record-aligned batches whose
+        //   buffers are recycled, so there is no allocation per row or batch
+        CSVChunkReader reader(filename);
 
-        while (std::getline(file, line)) {
-            if (line.empty()) continue;
+        size_t batchesRead = 0;
+        size_t bytesRead = 0;
 
-            std::string* linePtr = new std::string(std::move(line));
-
-            while (!queue.push(linePtr)) {
-                {
-                    ZoneScoped;
-                    ZoneName("Reader Waiting (Queue Full)", 28);
-                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+        while (true) {
+            RecordBatch* batch = nullptr;
+            {
+                ZoneScoped;
+                ZoneName("Reader Waiting (No Free Batch)", 30);
+                if (!pipeline.freeFor(file).pop(batch)) {
+                    break;
                 }
+            }
 
-                if (errorFlag) {
-                    delete linePtr;
-                    complete = true;
-                    return;
-                }
+            if (!reader.next(batch->data)) {
+                pipeline.freeFor(file).push(batch);
+                break;
             }
+            batch->file = file;
+            bytesRead += batch->data.size();
 
-            ++linesRead;
-#ifdef TRACY_ENABLE
-            if (linesRead % 1000 == 0) {
-                TracyPlot("Lines Read", static_cast<int64_t>(linesRead));
+            if (!pipeline.filled.push(batch)) {
+                break;
             }
+
+            ++batchesRead;
+#ifdef TRACY_ENABLE
+            TracyPlot("Bytes Read", static_cast<int64_t>(bytesRead));
 #endif
         }
 
-        complete = true;
 #ifdef TRACY_ENABLE
-        TracyPlot("Total Lines Read", static_cast<int64_t>(linesRead));
+        TracyPlot("Total Batches Read", static_cast<int64_t>(batchesRead));
 #endif
-
     }
     catch (const std::exception& e) {
         std::cerr << "Reader thread exception: " << e.what() << std::endl;
-        errorFlag = true;
-        complete = true;
+        pipeline.fail();
+    }
+
+    // The last reader out tells the parsers no more work is coming
+    if (--pipeline.readersLeft == 0) {
+        pipeline.filled.close();
     }
 }
 
-void ThreadedCSVComparator::parserThread(boost::lockfree::queue<std::string*>& queue1,
-    boost::lockfree::queue<std::string*>& queue2,
-    std::atomic<bool>& file1Complete,
-    std::atomic<bool>& file2Complete,
-    std::unordered_set<Row, Row::Hash>& rows1,
-    std::unordered_set<Row, Row::Hash>& rows2,
-    std::mutex& rows1Mutex,
-    std::mutex& rows2Mutex,
-    std::atomic<bool>& errorFlag) {
+void ThreadedCSVComparator::parserThread(Pipeline& pipeline,
+    ShardedRowTable& rows1,
+    ShardedRowTable& rows2) {
     ZoneScoped;
     ZoneName("Parser Thread", 13);
 
@@ -219,66 +232,27 @@ void ThreadedCSVComparator::parserThread(boost::lockfree::queue<std::string*>& q
 #endif
 
     try {
-        std::string* linePtr = nullptr;
         size_t rowsParsed = 0;
 
-        while (true) {
-            bool workDone = false;
-
-            if (queue1.pop(linePtr)) {
-                {
-                    ZoneScoped;
-                    ZoneName("Parse & Insert File1", 20);
-                    Row row = CSVParser::parseCSVRow(*linePtr);
-                    delete linePtr;
-                    linePtr = nullptr;
-
-                    {
-                        ZoneScoped;
-                        ZoneName("Lock File1 Mutex", 16);
-                        std::lock_guard<std::mutex> lock(rows1Mutex);
-                        rows1.insert(std::move(row));
-                    }
-                }
-                workDone = true;
-                ++rowsParsed;
-            }
-
-            if (queue2.pop(linePtr)) {
-                {
-                    ZoneScoped;
-                    ZoneName("Parse & Insert File2", 20);
-                    Row row = CSVParser::parseCSVRow(*linePtr);
-                    delete linePtr;
-                    linePtr = nullptr;
-
-                    {
-                        ZoneScoped;
-                        ZoneName("Lock File2 Mutex", 16);
-                        std::lock_guard<std::mutex> lock(rows2Mutex);
-                        rows2.insert(std::move(row));
-                    }
-                }
-                workDone = true;
-                ++rowsParsed;
-            }
-
-            if (!workDone) {
-                if (file1Complete && file2Complete &&
-                    queue1.empty() && queue2.empty()) {
-                    break;
-                }
-
-                {
-                    ZoneScoped;
-                    ZoneName("Parser Waiting", 14);
-                    std::this_thread::sleep_for(std::chrono::microseconds(100));
-                }
-            }
-
-            if (errorFlag) {
-                break;
+        //   OPTIMIZED: Rows are keyed and hashed into this thread's staging
+        //   store, then copied into their shard under that shard's spinlock;
+        //   no global mutex per row
+        RowStore staging;
+
+        // Blocks while no batch is ready; returns false once the readers are
+        // done and the queue is drained, or the run failed
+        RecordBatch* batch = nullptr;
+        while (pipeline.filled.pop(batch)) {
+            {
+                ZoneScoped;
+                ZoneName("Parse & Insert Batch", 20);
+                ShardedRowTable& rows = batch->file == 1 ? rows1 : rows2;
+                CSVParser::forEachRecord(batch->data, [&](const std::vector<std::string_view>& fields) {
+                    rows.insert(fields, staging);
+                    ++rowsParsed;
+                });
             }
+            pipeline.freeFor(batch->file).push(batch);
         }
 
 #ifdef TRACY_ENABLE
@@ -288,7 +262,7 @@ void ThreadedCSVComparator::parserThread(boost::lockfree::queue<std::string*>& q
     }
     catch (const std::exception& e) {
         std::cerr << "Parser thread exception: " << e.what() << std::endl;
-        errorFlag = true;
+        pipeline.fail();
     }
 }
 
@@ -299,19 +273,14 @@ ThreadedCSVComparator::compareMultiThreaded(const std::string& file1, const std:
 
     std::cout << "Using multi-threaded comparison..." << std::endl;
 
-    boost::lockfree::queue<std::string*> queue1(QUEUE_CAPACITY);
-    boost::lockfree::queue<std::string*> queue2(QUEUE_CAPACITY);
+    Pipeline pipeline(BATCHES_PER_INPUT);
 
-    std::unordered_set<Row, Row::Hash> rows1;
-    std::unordered_set<Row, Row::Hash> rows2;
-    std::mutex rows1Mutex;
-    std::mutex rows2Mutex;
+    ShardedRowTable rows1;
+    ShardedRowTable rows2;
 
-    std::atomic<bool> file1Complete{ false };
-    std::atomic<bool> file2Complete{ false };
-    std::atomic<bool> errorFlag{ false };
-
-    unsigned int numParsers = std::max(2u, std::thread::hardware_concurrency() - 2);
+    // Two cores go to the readers; hardware_concurrency() may report 0 or 1
+    unsigned int cores = std::thread::hardware_concurrency();
+    unsigned int numParsers = std::max(2u, cores > 2 ? cores - 2 : 0u);
     std::cout << "Using " << numParsers << " parser threads" << std::endl;
 #ifdef TRACY_ENABLE
     TracyPlot("Parser Thread Count", static_cast<int64_t>(numParsers));
@@ -321,20 +290,18 @@ ThreadedCSVComparator::compareMultiThreaded(const std::string& file1, const std:
         ZoneScoped;
         ZoneName("Threaded Processing", 19);
 
-        std::thread reader1([this, &file1, &queue1, &file1Complete, &errorFlag]() {
-            readerThread(file1, queue1, file1Complete, errorFlag);
+        std::thread reader1([this, &file1, &pipeline]() {
+            readerThread(file1, 1, pipeline);
             });
 
-        std::thread reader2([this, &file2, &queue2, &file2Complete, &errorFlag]() {
-            readerThread(file2, queue2, file2Complete, errorFlag);
+        std::thread reader2([this, &file2, &pipeline]() {
+            readerThread(file2, 2, pipeline);
             });
 
         std::vector<std::thread> parsers;
         for (unsigned int i = 0; i < numParsers; ++i) {
-            parsers.emplace_back([this, &queue1, &queue2, &file1Complete, &file2Complete,
-                &rows1, &rows2, &rows1Mutex, &rows2Mutex, &errorFlag]() {
-                    parserThread(queue1, queue2, file1Complete, file2Complete,
-                        rows1, rows2, rows1Mutex, rows2Mutex, errorFlag);
+            parsers.emplace_back([this, &pipeline, &rows1, &rows2]() {
+                    parserThread(pipeline, rows1, rows2);
                 });
         }
 
@@ -346,7 +313,7 @@ ThreadedCSVComparator::compareMultiThreaded(const std::string& file1, const std:
         }
     }
 
-    if (errorFlag) {
+    if (pipeline.failed) {
         throw std::runtime_error("Error occurred during multi-threaded processing");
     }
 
@@ -363,15 +330,22 @@ ThreadedCSVComparator::compareMultiThreaded(const std::string& file1, const std:
         ZoneScoped;
         ZoneName("Find Differences", 16);
 
-        for (const auto& row : rows1) {
-            if (rows2.find(row) == rows2.end()) {
-                result.onlyInFile1.push_back(row);
+        // Equal rows hash alike, so each shard only has to be probed against
+        // the same shard of the other side
+        for (size_t shard = 0; shard < ShardedRowTable::SHARDS; ++shard) {
+            const RowTable& shard1 = rows1.shard(shard);
+            const RowTable& shard2 = rows2.shard(shard);
+
+            for (RowStore::RowId id : shard1) {
+                if (!shard2.contains(shard1.store(), id)) {
+                    result.onlyInFile1.push_back(shard1.store().materialize(id));
+                }
             }
-        }
 
-        for (const auto& row : rows2) {
-            if (rows1.find(row) == rows1.end()) {
-                result.onlyInFile2.push_back(row);
+            for (RowStore::RowId id : shard2) {
+                if (!shard1.contains(shard2.store(), id)) {
+                    result.onlyInFile2.push_back(shard2.store().materialize(id));
+                }
             }
         }
     }
@@ -395,11 +369,11 @@ ThreadedCSVComparator::compare(const std::string& file1, const std::string& file
     std::cout << "  File 2: " << file2 << std::endl;
     std::cout << std::endl;
 
-    std::cout << "Counting rows..." << std::endl;
-    size_t rows1 = countRows(file1);
-    size_t rows2 = countRows(file2);
-    std::cout << "  File 1: " << rows1 << " rows" << std::endl;
-    std::cout << "  File 2: " << rows2 << " rows" << std::endl;
+    std::cout << "Estimating rows..." << std::endl;
+    size_t rows1 = estimateRows(file1);
+    size_t rows2 = estimateRows(file2);
+    std::cout << "  File 1: ~" << rows1 << " rows" << std::endl;
+    std::cout << "  File 2: ~" << rows2 << " rows" << std::endl;
     std::cout << std::endl;
 
     ComparisonResult result;
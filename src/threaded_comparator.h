@@ -1,14 +1,12 @@
 #pragma once
 
 #include "row.h"
+#include "row_store.h"
 #include <string>
-#include <unordered_set>
 #include <vector>
 #include <thread>
 #include <atomic>
-#include <mutex>
 #include <memory>
-#include <boost/lockfree/queue.hpp>
 
 // Tracy profiler integration
 #ifdef TRACY_ENABLE
@@ -41,27 +39,27 @@ public:
     void writeRowsToCSV(const std::string& filename, const std::vector<Row>& rows);
 
 private:
-    static constexpr size_t QUEUE_CAPACITY = 10000;
+    // Recycled record batches per input (about one 1 MiB read block each)
+    static constexpr size_t BATCHES_PER_INPUT = 16;
     static constexpr size_t ROW_THRESHOLD = 1000;
 
-    size_t countRows(const std::string& filename);
+    size_t estimateRows(const std::string& filename);
     ComparisonResult compareSingleThreaded(const std::string& file1, const std::string& file2);
     ComparisonResult compareMultiThreaded(const std::string& file1, const std::string& file2);
 
-    void readerThread(const std::string& filename,
-        boost::lockfree::queue<std::string*>& queue,
-        std::atomic<bool>& complete,
-        std::atomic<bool>& errorFlag);
+    // Whole records of one input, parsed independently of other batches
+    struct RecordBatch {
+        std::string data;
+        int file = 1;
+    };
+
+    struct Pipeline;
+
+    void readerThread(const std::string& filename, int file, Pipeline& pipeline);
 
-    void parserThread(boost::lockfree::queue<std::string*>& queue1,
-        boost::lockfree::queue<std::string*>& queue2,
-        std::atomic<bool>& file1Complete,
-        std::atomic<bool>& file2Complete,
-        std::unordered_set<Row, Row::Hash>& rows1,
-        std::unordered_set<Row, Row::Hash>& rows2,
-        std::mutex& rows1Mutex,
-        std::mutex& rows2Mutex,
-        std::atomic<bool>& errorFlag);
+    void parserThread(Pipeline& pipeline,
+        ShardedRowTable& rows1,
+        ShardedRowTable& rows2);
 
-    std::unordered_set<Row, Row::Hash> readCSV(const std::string& filename);
+    void readCSV(const std::string& filename, RowTable& rows);
 };
\ No newline at end of file
@@ -0,0 +1,702 @@
+#include "xlsx_reader.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <deque>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+// ============ XML PULL PARSER ============
+
+// Minimal non-validating pull parser over a ZIP entry stream. Only the
+// subset of XML that SpreadsheetML parts use is supported: elements,
+// attributes, character data, CDATA, comments and processing instructions.
+// Views returned by name()/text()/attribute() are valid until next().
+class XmlPullParser {
+public:
+    enum class Event { StartElement, EndElement, Text, End };
+
+    explicit XmlPullParser(ZipArchive::EntryStream& stream)
+        : stream_(stream) {
+    }
+
+    Event next();
+
+    // Local name of the current element (namespace prefix stripped)
+    std::string_view name() const { return name_; }
+
+    // Character data of the current Text event, entities decoded
+    std::string_view text() const { return text_; }
+
+    // Decoded value of an attribute of the current start element, looked
+    // up by local name; empty when absent
+    std::string_view attribute(std::string_view localName);
+
+private:
+    static constexpr size_t CHUNK_BYTES = 64 * 1024;
+
+    bool fill();
+    void ensure(size_t bytes);
+    size_t find(std::string_view needle, size_t from);
+    size_t findTagEnd(size_t from);
+    void parseAttributes(std::string_view tag);
+
+    ZipArchive::EntryStream& stream_;
+
+    // Unconsumed input is buffer_[pos_, size); offsets returned by the
+    // search helpers are relative to pos_ because fill() compacts
+    std::string buffer_;
+    size_t pos_ = 0;
+    bool eof_ = false;
+    bool pendingEnd_ = false;
+
+    std::string_view name_;
+    std::string_view text_;
+    std::string decodedText_;
+    std::vector<std::pair<std::string_view, std::string_view>> attributes_;
+    std::deque<std::string> decodedAttributes_;
+};
+
+[[noreturn]] void malformed(const char* what) {
+    throw std::runtime_error(std::string("Malformed XML: ") + what);
+}
+
+std::string_view localNameOf(std::string_view qualified) {
+    size_t colon = qualified.find(':');
+    return colon == std::string_view::npos ? qualified : qualified.substr(colon + 1);
+}
+
+inline bool isXmlSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+void appendUtf8(uint32_t codepoint, std::string& out) {
+    if (codepoint < 0x80) {
+        out += static_cast<char>(codepoint);
+    }
+    else if (codepoint < 0x800) {
+        out += static_cast<char>(0xC0 | (codepoint >> 6));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+    else if (codepoint < 0x10000) {
+        out += static_cast<char>(0xE0 | (codepoint >> 12));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+    else {
+        out += static_cast<char>(0xF0 | (codepoint >> 18));
+        out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+}
+
+// Resolves entity references and normalizes line ends. Returns `raw` itself
+// when there is nothing to decode, otherwise a view of `storage`.
+std::string_view decode(std::string_view raw, std::string& storage) {
+    if (raw.find_first_of("&\r") == std::string_view::npos) {
+        return raw;
+    }
+
+    storage.clear();
+    storage.reserve(raw.size());
+
+    for (size_t i = 0; i < raw.size(); ++i) {
+        char c = raw[i];
+        if (c == '\r') {
+            storage += '\n';
+            if (i + 1 < raw.size() && raw[i + 1] == '\n') ++i;
+            continue;
+        }
+        if (c != '&') {
+            storage += c;
+            continue;
+        }
+
+        size_t semicolon = raw.find(';', i + 1);
+        if (semicolon == std::string_view::npos) {
+            storage += c;
+            continue;
+        }
+
+        std::string_view entity = raw.substr(i + 1, semicolon - i - 1);
+        if (entity == "amp") storage += '&';
+        else if (entity == "lt") storage += '<';
+        else if (entity == "gt") storage += '>';
+        else if (entity == "quot") storage += '"';
+        else if (entity == "apos") storage += '\'';
+        else if (entity.size() > 1 && entity[0] == '#') {
+            bool hex = entity[1] == 'x' || entity[1] == 'X';
+            std::string_view digits = entity.substr(hex ? 2 : 1);
+            uint32_t codepoint = 0;
+            auto [ptr, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), codepoint, hex ? 16 : 10);
+            if (ec != std::errc() || ptr != digits.data() + digits.size() || codepoint > 0x10FFFF) {
+                storage.append(raw.substr(i, semicolon - i + 1));
+            }
+            else {
+                appendUtf8(codepoint, storage);
+            }
+        }
+        else {
+            // Unknown entity: keep it verbatim
+            storage.append(raw.substr(i, semicolon - i + 1));
+        }
+        i = semicolon;
+    }
+
+    return storage;
+}
+
+bool XmlPullParser::fill() {
+    if (eof_) {
+        return false;
+    }
+
+    if (pos_ > 0) {
+        buffer_.erase(0, pos_);
+        pos_ = 0;
+    }
+
+    size_t used = buffer_.size();
+    buffer_.resize(used + CHUNK_BYTES);
+    size_t count = stream_.read(buffer_.data() + used, CHUNK_BYTES);
+    buffer_.resize(used + count);
+
+    eof_ = count == 0;
+    return count > 0;
+}
+
+void XmlPullParser::ensure(size_t bytes) {
+    while (buffer_.size() - pos_ < bytes && fill()) {
+    }
+}
+
+size_t XmlPullParser::find(std::string_view needle, size_t from) {
+    for (;;) {
+        size_t hit = std::string_view(buffer_).find(needle, pos_ + from);
+        if (hit != std::string_view::npos) {
+            return hit - pos_;
+        }
+
+        // Resume just before the old end so a needle split across chunks is found
+        size_t available = buffer_.size() - pos_;
+        if (available >= needle.size()) {
+            from = std::max(from, available - needle.size() + 1);
+        }
+        if (!fill()) {
+            return std::string_view::npos;
+        }
+    }
+}
+
+size_t XmlPullParser::findTagEnd(size_t from) {
+    // '>' may legally appear inside quoted attribute values
+    char quote = 0;
+    size_t i = from;
+    for (;;) {
+        for (; pos_ + i < buffer_.size(); ++i) {
+            char c = buffer_[pos_ + i];
+            if (quote != 0) {
+                if (c == quote) quote = 0;
+            }
+            else if (c == '"' || c == '\'') {
+                quote = c;
+            }
+            else if (c == '>') {
+                return i;
+            }
+        }
+        if (!fill()) {
+            return std::string_view::npos;
+        }
+    }
+}
+
+XmlPullParser::Event XmlPullParser::next() {
+    if (pendingEnd_) {
+        // Second half of a self-closing element; name_ is still valid
+        pendingEnd_ = false;
+        return Event::EndElement;
+    }
+
+    for (;;) {
+        if (pos_ >= buffer_.size() && !fill()) {
+            return Event::End;
+        }
+
+        if (buffer_[pos_] != '<') {
+            size_t end = find("<", 0);
+            size_t length = end == std::string_view::npos ? buffer_.size() - pos_ : end;
+            std::string_view raw(buffer_.data() + pos_, length);
+            pos_ += length;
+            text_ = decode(raw, decodedText_);
+            return Event::Text;
+        }
+
+        ensure(9);
+        std::string_view head(buffer_.data() + pos_, std::min<size_t>(9, buffer_.size() - pos_));
+
+        if (head.starts_with("<?")) {
+            size_t end = find("?>", 2);
+            if (end == std::string_view::npos) malformed("unterminated processing instruction");
+            pos_ += end + 2;
+            continue;
+        }
+        if (head.starts_with("<!--")) {
+            size_t end = find("-->", 4);
+            if (end == std::string_view::npos) malformed("unterminated comment");
+            pos_ += end + 3;
+            continue;
+        }
+        if (head.starts_with("<![CDATA[")) {
+            size_t end = find("]]>", 9);
+            if (end == std::string_view::npos) malformed("unterminated CDATA section");
+            text_ = std::string_view(buffer_.data() + pos_ + 9, end - 9);
+            pos_ += end + 3;
+            return Event::Text;
+        }
+        if (head.starts_with("<!")) {
+            size_t end = findTagEnd(2);
+            if (end == std::string_view::npos) malformed("unterminated declaration");
+            pos_ += end + 1;
+            continue;
+        }
+
+        size_t end = findTagEnd(1);
+        if (end == std::string_view::npos) {
+            malformed("unterminated tag");
+        }
+
+        std::string_view tag(buffer_.data() + pos_ + 1, end - 1);
+        pos_ += end + 1;
+
+        if (!tag.empty() && tag.front() == '/') {
+            tag.remove_prefix(1);
+            while (!tag.empty() && isXmlSpace(tag.back())) tag.remove_suffix(1);
+            name_ = localNameOf(tag);
+            return Event::EndElement;
+        }
+
+        pendingEnd_ = !tag.empty() && tag.back() == '/';
+        if (pendingEnd_) {
+            tag.remove_suffix(1);
+        }
+
+        size_t nameEnd = 0;
+        while (nameEnd < tag.size() && !isXmlSpace(tag[nameEnd])) ++nameEnd;
+        if (nameEnd == 0) {
+            malformed("empty element name");
+        }
+        name_ = localNameOf(tag.substr(0, nameEnd));
+        parseAttributes(tag.substr(nameEnd));
+        return Event::StartElement;
+    }
+}
+
+void XmlPullParser::parseAttributes(std::string_view tag) {
+    attributes_.clear();
+    decodedAttributes_.clear();
+
+    size_t i = 0;
+    for (;;) {
+        while (i < tag.size() && isXmlSpace(tag[i])) ++i;
+        if (i >= tag.size()) {
+            return;
+        }
+
+        size_t nameStart = i;
+        while (i < tag.size() && tag[i] != '=' && !isXmlSpace(tag[i])) ++i;
+        std::string_view attributeName = tag.substr(nameStart, i - nameStart);
+
+        while (i < tag.size() && isXmlSpace(tag[i])) ++i;
+        if (i >= tag.size() || tag[i] != '=') malformed("attribute without value");
+        ++i;
+        while (i < tag.size() && isXmlSpace(tag[i])) ++i;
+        if (i >= tag.size() || (tag[i] != '"' && tag[i] != '\'')) malformed("unquoted attribute value");
+
+        char quote = tag[i++];
+        size_t valueEnd = tag.find(quote, i);
+        if (valueEnd == std::string_view::npos) malformed("unterminated attribute value");
+
+        attributes_.emplace_back(localNameOf(attributeName), tag.substr(i, valueEnd - i));
+        i = valueEnd + 1;
+    }
+}
+
+std::string_view XmlPullParser::attribute(std::string_view localName) {
+    for (const auto& [attributeName, raw] : attributes_) {
+        if (attributeName == localName) {
+            // Deque elements stay put, so earlier decoded views remain valid
+            return decode(raw, decodedAttributes_.emplace_back());
+        }
+    }
+    return {};
+}
+
+// ============ PART HELPERS ============
+
+// Resolves a relationship target against the directory of its source part
+std::string resolvePart(std::string_view baseDirectory, std::string_view target) {
+    std::string path;
+    if (!target.empty() && target.front() == '/') {
+        target.remove_prefix(1);
+    }
+    else {
+        path = baseDirectory;
+    }
+
+    size_t start = 0;
+    while (start <= target.size()) {
+        size_t slash = target.find('/', start);
+        if (slash == std::string_view::npos) slash = target.size();
+        std::string_view segment = target.substr(start, slash - start);
+
+        if (segment == "..") {
+            // Drop the last directory of the path built so far
+            if (!path.empty()) path.pop_back();
+            size_t parent = path.rfind('/');
+            path.erase(parent == std::string::npos ? 0 : parent + 1);
+        }
+        else if (!segment.empty() && segment != ".") {
+            path.append(segment);
+            if (slash < target.size()) path += '/';
+        }
+        start = slash + 1;
+    }
+    return path;
+}
+
+std::string directoryOf(std::string_view part) {
+    size_t slash = part.rfind('/');
+    return std::string(slash == std::string_view::npos ? std::string_view() : part.substr(0, slash + 1));
+}
+
+// Relationships part that belongs to `part`, e.g. xl/_rels/workbook.xml.rels
+std::string relationshipsOf(std::string_view part) {
+    size_t slash = part.rfind('/');
+    size_t fileStart = slash == std::string_view::npos ? 0 : slash + 1;
+    return std::string(part.substr(0, fileStart)) + "_rels/" + std::string(part.substr(fileStart)) + ".rels";
+}
+
+// Calls fn(parser) for every start element of a part
+template <typename Fn>
+void forEachStartElement(const ZipArchive& archive, const ZipArchive::Entry& entry, Fn&& fn) {
+    ZipArchive::EntryStream stream(archive, entry);
+    XmlPullParser parser(stream);
+
+    for (auto event = parser.next(); event != XmlPullParser::Event::End; event = parser.next()) {
+        if (event == XmlPullParser::Event::StartElement) {
+            fn(parser);
+        }
+    }
+}
+
+// Numbers render as integers when whole, otherwise with up to 10 decimals
+void formatNumber(std::string_view raw, std::string& out) {
+    double d = 0.0;
+    auto [ptr, ec] = std::from_chars(raw.data(), raw.data() + raw.size(), d);
+    if (ec != std::errc() || ptr != raw.data() + raw.size()) {
+        out.assign(raw);
+        return;
+    }
+
+    // Room for the widest fixed-notation double
+    char buffer[400];
+    if (d == std::floor(d) && std::abs(d) < 1e15) {
+        // Integer - no decimal point
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), static_cast<long long>(d));
+        out.assign(buffer, result.ptr);
+        return;
+    }
+
+    // Floating point - preserve precision
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), d, std::chars_format::fixed, 10);
+    out.assign(buffer, result.ptr);
+
+    // Remove trailing zeros
+    out.erase(out.find_last_not_of('0') + 1);
+    if (out.back() == '.') {
+        out.pop_back();
+    }
+}
+
+} // namespace
+
+// ============ XLSX READER ============
+
+XLSXReader::XLSXReader(const std::string& filename)
+    : archive_(filename) {
+    locateParts();
+}
+
+void XLSXReader::locateParts() {
+    // The package relationships name the workbook part
+    std::string workbookPath = "xl/workbook.xml";
+    if (const auto* packageRels = archive_.find("_rels/.rels")) {
+        forEachStartElement(archive_, *packageRels, [&](XmlPullParser& parser) {
+            if (parser.name() == "Relationship" && parser.attribute("Type").ends_with("/officeDocument")) {
+                workbookPath = resolvePart("", parser.attribute("Target"));
+            }
+        });
+    }
+
+    const auto* workbook = archive_.find(workbookPath);
+    if (!workbook) {
+        throw std::runtime_error("Workbook part not found in XLSX file");
+    }
+
+    std::vector<std::string> sheetIds;
+    size_t activeTab = 0;
+    bool sawView = false;
+
+    forEachStartElement(archive_, *workbook, [&](XmlPullParser& parser) {
+        if (parser.name() == "sheet") {
+            sheetIds.emplace_back(parser.attribute("id"));
+        }
+        else if (parser.name() == "workbookView" && !sawView) {
+            sawView = true;
+            std::string_view tab = parser.attribute("activeTab");
+            std::from_chars(tab.data(), tab.data() + tab.size(), activeTab);
+        }
+    });
+
+    if (sheetIds.empty()) {
+        throw std::runtime_error("No sheets found in XLSX file");
+    }
+    if (activeTab >= sheetIds.size()) {
+        activeTab = 0;
+    }
+
+    std::string baseDirectory = directoryOf(workbookPath);
+    sharedStringsPath_ = baseDirectory + "sharedStrings.xml";
+
+    if (const auto* workbookRels = archive_.find(relationshipsOf(workbookPath))) {
+        forEachStartElement(archive_, *workbookRels, [&](XmlPullParser& parser) {
+            if (parser.name() != "Relationship") {
+                return;
+            }
+            if (parser.attribute("Id") == sheetIds[activeTab]) {
+                sheetPath_ = resolvePart(baseDirectory, parser.attribute("Target"));
+            }
+            else if (parser.attribute("Type").ends_with("/sharedStrings")) {
+                sharedStringsPath_ = resolvePart(baseDirectory, parser.attribute("Target"));
+            }
+        });
+    }
+
+    if (sheetPath_.empty() || !archive_.find(sheetPath_)) {
+        throw std::runtime_error("Active worksheet part not found in XLSX file");
+    }
+}
+
+void XLSXReader::loadSharedStrings() {
+    ZoneScoped;
+    ZoneName("Load Shared Strings", 19);
+
+    sharedBytes_.clear();
+    sharedOffsets_.assign(1, 0);
+
+    const auto* entry = archive_.find(sharedStringsPath_);
+    if (!entry) {
+        return;
+    }
+
+    ZipArchive::EntryStream stream(archive_, *entry);
+    XmlPullParser parser(stream);
+
+    // Rich text items concatenate the <t> of every run; phonetic runs are skipped
+    bool inText = false;
+    int phoneticDepth = 0;
+
+    for (auto event = parser.next(); event != XmlPullParser::Event::End; event = parser.next()) {
+        switch (event) {
+        case XmlPullParser::Event::StartElement:
+            if (parser.name() == "t") {
+                inText = true;
+            }
+            else if (parser.name() == "rPh") {
+                ++phoneticDepth;
+            }
+            else if (parser.name() == "sst") {
+                size_t unique = 0;
+                std::string_view count = parser.attribute("uniqueCount");
+                std::from_chars(count.data(), count.data() + count.size(), unique);
+                sharedOffsets_.reserve(unique + 1);
+            }
+            break;
+
+        case XmlPullParser::Event::EndElement:
+            if (parser.name() == "t") {
+                inText = false;
+            }
+            else if (parser.name() == "rPh") {
+                --phoneticDepth;
+            }
+            else if (parser.name() == "si") {
+                sharedOffsets_.push_back(sharedBytes_.size());
+            }
+            break;
+
+        case XmlPullParser::Event::Text:
+            if (inText && phoneticDepth == 0) {
+                sharedBytes_.append(parser.text());
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+std::string_view XLSXReader::sharedString(std::string_view index) const {
+    size_t i = 0;
+    auto [ptr, ec] = std::from_chars(index.data(), index.data() + index.size(), i);
+    if (ec != std::errc() || ptr != index.data() + index.size() || i + 1 >= sharedOffsets_.size()) {
+        throw std::runtime_error("Invalid shared string index: " + std::string(index));
+    }
+    return std::string_view(sharedBytes_).substr(sharedOffsets_[i], sharedOffsets_[i + 1] - sharedOffsets_[i]);
+}
+
+size_t XLSXReader::estimateRows() {
+    ZipArchive::EntryStream stream(archive_, *archive_.find(sheetPath_));
+    XmlPullParser parser(stream);
+
+    for (auto event = parser.next(); event != XmlPullParser::Event::End; event = parser.next()) {
+        if (event != XmlPullParser::Event::StartElement) {
+            continue;
+        }
+        if (parser.name() == "sheetData") {
+            break;
+        }
+        if (parser.name() == "dimension") {
+            // ref="A1:J10001": the row number of the last reference
+            std::string_view ref = parser.attribute("ref");
+            size_t digits = ref.find_last_not_of("0123456789") + 1;
+            size_t rows = 0;
+            std::from_chars(ref.data() + digits, ref.data() + ref.size(), rows);
+            return rows;
+        }
+    }
+    return 0;
+}
+
+size_t XLSXReader::forEachRow(const RowCallback& fn) {
+    loadSharedStrings();
+
+    ZoneScoped;
+    ZoneName("Parse XLSX Rows", 15);
+
+    ZipArchive::EntryStream stream(archive_, *archive_.find(sheetPath_));
+    XmlPullParser parser(stream);
+
+    // Per-cell storage; a deque so views into earlier cells survive growth
+    std::deque<std::string> values;
+    std::vector<std::string_view> cells;
+    size_t used = 0;
+    size_t count = 0;
+
+    std::string cellType;
+    std::string raw;
+    bool inSheetData = false;
+    bool inValue = false;
+    bool inInlineString = false;
+    bool inText = false;
+    bool hasValue = false;
+    int phoneticDepth = 0;
+
+    for (auto event = parser.next(); event != XmlPullParser::Event::End; event = parser.next()) {
+        if (event == XmlPullParser::Event::StartElement) {
+            std::string_view name = parser.name();
+            if (name == "sheetData") {
+                inSheetData = true;
+            }
+            else if (!inSheetData) {
+                continue;
+            }
+            else if (name == "row") {
+                cells.clear();
+                used = 0;
+            }
+            else if (name == "c") {
+                cellType = parser.attribute("t");
+                raw.clear();
+                hasValue = false;
+            }
+            else if (name == "v") {
+                inValue = true;
+                hasValue = true;
+            }
+            else if (name == "is") {
+                inInlineString = true;
+                hasValue = true;
+            }
+            else if (name == "t") {
+                inText = true;
+            }
+            else if (name == "rPh") {
+                ++phoneticDepth;
+            }
+        }
+        else if (event == XmlPullParser::Event::Text) {
+            if (inValue || (inInlineString && inText && phoneticDepth == 0)) {
+                raw.append(parser.text());
+            }
+        }
+        else if (event == XmlPullParser::Event::EndElement && inSheetData) {
+            std::string_view name = parser.name();
+            if (name == "v") {
+                inValue = false;
+            }
+            else if (name == "is") {
+                inInlineString = false;
+            }
+            else if (name == "t") {
+                inText = false;
+            }
+            else if (name == "rPh") {
+                --phoneticDepth;
+            }
+            else if (name == "c") {
+                if (!hasValue) {
+                    // Empty cell
+                    cells.emplace_back();
+                }
+                else if (cellType == "s") {
+                    cells.push_back(sharedString(raw));
+                }
+                else if (cellType == "b") {
+                    cells.push_back((raw == "1" || raw == "true") ? "true" : "false");
+                }
+                else {
+                    if (used == values.size()) {
+                        values.emplace_back();
+                    }
+                    std::string& value = values[used++];
+
+                    if (cellType.empty() || cellType == "n") {
+                        formatNumber(raw, value);
+                    }
+                    else {
+                        // Inline strings, cached formula strings, errors and ISO dates
+                        value = raw;
+                    }
+                    cells.push_back(value);
+                }
+            }
+            else if (name == "row") {
+                if (!cells.empty()) {
+                    fn(cells);
+                    ++count;
+                }
+            }
+            else if (name == "sheetData") {
+                break;
+            }
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "zip_archive.h"
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Tracy profiler integration
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#else
+#define ZoneScoped
+#define ZoneScopedN(name)
+#define ZoneName(name, size)
+#define TracyPlot(name, value)
+#define FrameMark
+#define FrameMarkNamed(name)
+#endif
+
+// Streaming reader for the active worksheet of an XLSX workbook.
+// The worksheet XML is inflated in fixed-size chunks and pull-parsed row by
+// row, so memory is bounded by the shared-string table and a single row
+// instead of the whole workbook object model.
+class XLSXReader {
+public:
+    using RowCallback = std::function<void(const std::vector<std::string_view>&)>;
+
+    // Opens the archive and resolves the active sheet and shared strings parts
+    explicit XLSXReader(const std::string& filename);
+
+    // Calls fn once per non-empty row with the cells rendered as strings
+    // (numbers, booleans, shared/inline strings, cached formula values).
+    // The views are only valid during the call. Returns the row count.
+    size_t forEachRow(const RowCallback& fn);
+
+    // Row count from the sheet's <dimension> element (0 when absent), read
+    // from the first few bytes of the sheet for pre-sizing tables
+    size_t estimateRows();
+
+private:
+    void locateParts();
+    void loadSharedStrings();
+    std::string_view sharedString(std::string_view index) const;
+
+    ZipArchive archive_;
+    std::string sheetPath_;
+    std::string sharedStringsPath_;
+
+    // Shared strings packed back to back: string i is
+    // sharedBytes_[sharedOffsets_[i], sharedOffsets_[i + 1])
+    std::string sharedBytes_;
+    std::vector<size_t> sharedOffsets_;
+};
@@ -0,0 +1,218 @@
+#include "zip_archive.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+constexpr uint32_t LOCAL_HEADER_SIGNATURE = 0x04034b50;
+constexpr uint32_t CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+constexpr uint32_t END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06054b50;
+constexpr uint32_t ZIP64_END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06064b50;
+constexpr uint32_t ZIP64_LOCATOR_SIGNATURE = 0x07064b50;
+constexpr uint16_t ZIP64_EXTRA_FIELD = 0x0001;
+
+constexpr uint16_t METHOD_STORED = 0;
+constexpr uint16_t METHOD_DEFLATED = 8;
+
+[[noreturn]] void corrupt(const char* what) {
+    throw std::runtime_error(std::string("Corrupt ZIP archive: ") + what);
+}
+
+// Little-endian field readers with bounds checking
+template <typename T>
+T readLE(std::string_view data, uint64_t offset) {
+    if (offset > data.size() || data.size() - offset < sizeof(T)) {
+        corrupt("field out of bounds");
+    }
+    T value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        value |= static_cast<T>(static_cast<uint8_t>(data[offset + i])) << (8 * i);
+    }
+    return value;
+}
+
+} // namespace
+
+ZipArchive::ZipArchive(const std::string& filename)
+    : file_(filename) {
+    readCentralDirectory();
+}
+
+void ZipArchive::readCentralDirectory() {
+    std::string_view data = file_.data();
+
+    // The end-of-central-directory record sits in the last 22 + 65535 bytes
+    constexpr size_t EOCD_SIZE = 22;
+    if (data.size() < EOCD_SIZE) {
+        corrupt("file too small");
+    }
+
+    size_t searchFloor = data.size() > EOCD_SIZE + 0xFFFF ? data.size() - EOCD_SIZE - 0xFFFF : 0;
+    size_t eocd = std::string_view::npos;
+    for (size_t pos = data.size() - EOCD_SIZE + 1; pos-- > searchFloor;) {
+        if (readLE<uint32_t>(data, pos) == END_OF_CENTRAL_DIRECTORY_SIGNATURE) {
+            eocd = pos;
+            break;
+        }
+    }
+    if (eocd == std::string_view::npos) {
+        corrupt("end of central directory not found");
+    }
+
+    uint64_t entryCount = readLE<uint16_t>(data, eocd + 10);
+    uint64_t directoryOffset = readLE<uint32_t>(data, eocd + 16);
+
+    // ZIP64: the classic record holds saturated values and a locator precedes it
+    if ((entryCount == 0xFFFF || directoryOffset == 0xFFFFFFFF) && eocd >= 20 &&
+        readLE<uint32_t>(data, eocd - 20) == ZIP64_LOCATOR_SIGNATURE) {
+        uint64_t zip64Eocd = readLE<uint64_t>(data, eocd - 20 + 8);
+        if (readLE<uint32_t>(data, zip64Eocd) != ZIP64_END_OF_CENTRAL_DIRECTORY_SIGNATURE) {
+            corrupt("bad ZIP64 end of central directory");
+        }
+        entryCount = readLE<uint64_t>(data, zip64Eocd + 32);
+        directoryOffset = readLE<uint64_t>(data, zip64Eocd + 48);
+    }
+
+    entries_.reserve(static_cast<size_t>(std::min<uint64_t>(entryCount, 4096)));
+
+    uint64_t pos = directoryOffset;
+    for (uint64_t i = 0; i < entryCount; ++i) {
+        if (readLE<uint32_t>(data, pos) != CENTRAL_HEADER_SIGNATURE) {
+            corrupt("bad central directory entry");
+        }
+
+        Entry entry;
+        entry.method = readLE<uint16_t>(data, pos + 10);
+        entry.compressedSize = readLE<uint32_t>(data, pos + 20);
+        entry.uncompressedSize = readLE<uint32_t>(data, pos + 24);
+        uint16_t nameLength = readLE<uint16_t>(data, pos + 28);
+        uint16_t extraLength = readLE<uint16_t>(data, pos + 30);
+        uint16_t commentLength = readLE<uint16_t>(data, pos + 32);
+        entry.localHeaderOffset = readLE<uint32_t>(data, pos + 42);
+
+        if (pos + 46 + nameLength > data.size()) {
+            corrupt("entry name out of bounds");
+        }
+        entry.name.assign(data.substr(static_cast<size_t>(pos + 46), nameLength));
+
+        // ZIP64 extra field carries the 64-bit values that were saturated above
+        uint64_t extra = pos + 46 + nameLength;
+        uint64_t extraEnd = extra + extraLength;
+        while (extra + 4 <= extraEnd) {
+            uint16_t id = readLE<uint16_t>(data, extra);
+            uint16_t size = readLE<uint16_t>(data, extra + 2);
+            if (id == ZIP64_EXTRA_FIELD) {
+                uint64_t field = extra + 4;
+                if (entry.uncompressedSize == 0xFFFFFFFF) {
+                    entry.uncompressedSize = readLE<uint64_t>(data, field);
+                    field += 8;
+                }
+                if (entry.compressedSize == 0xFFFFFFFF) {
+                    entry.compressedSize = readLE<uint64_t>(data, field);
+                    field += 8;
+                }
+                if (entry.localHeaderOffset == 0xFFFFFFFF) {
+                    entry.localHeaderOffset = readLE<uint64_t>(data, field);
+                }
+            }
+            extra += 4 + size;
+        }
+
+        entries_.push_back(std::move(entry));
+        pos += 46 + nameLength + extraLength + commentLength;
+    }
+}
+
+const ZipArchive::Entry* ZipArchive::find(std::string_view name) const {
+    for (const auto& entry : entries_) {
+        if (entry.name == name) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+// ============ ENTRY STREAM ============
+
+struct ZipArchive::EntryStream::InflateState {
+    z_stream stream{};
+};
+
+ZipArchive::EntryStream::EntryStream(const ZipArchive& archive, const Entry& entry)
+    : method_(entry.method) {
+
+    std::string_view data = archive.file_.data();
+    uint64_t header = entry.localHeaderOffset;
+    if (readLE<uint32_t>(data, header) != LOCAL_HEADER_SIGNATURE) {
+        corrupt("bad local file header");
+    }
+
+    // Local name/extra lengths may differ from the central directory copy
+    uint64_t start = header + 30 + readLE<uint16_t>(data, header + 26) + readLE<uint16_t>(data, header + 28);
+    if (start > data.size() || data.size() - start < entry.compressedSize) {
+        corrupt("entry data out of bounds");
+    }
+    compressed_ = data.substr(static_cast<size_t>(start), static_cast<size_t>(entry.compressedSize));
+
+    if (method_ == METHOD_DEFLATED) {
+        inflate_ = std::make_unique<InflateState>();
+        // Negative window bits: raw deflate data without a zlib header
+        if (inflateInit2(&inflate_->stream, -MAX_WBITS) != Z_OK) {
+            throw std::runtime_error("Could not initialize inflate stream");
+        }
+    }
+    else if (method_ != METHOD_STORED) {
+        throw std::runtime_error("Unsupported ZIP compression method for entry: " + entry.name);
+    }
+}
+
+ZipArchive::EntryStream::~EntryStream() {
+    if (inflate_) {
+        inflateEnd(&inflate_->stream);
+    }
+}
+
+size_t ZipArchive::EntryStream::read(char* buffer, size_t capacity) {
+    if (finished_ || capacity == 0) {
+        return 0;
+    }
+
+    if (method_ == METHOD_STORED) {
+        size_t count = std::min(capacity, compressed_.size() - consumed_);
+        std::memcpy(buffer, compressed_.data() + consumed_, count);
+        consumed_ += count;
+        finished_ = consumed_ == compressed_.size();
+        return count;
+    }
+
+    constexpr size_t MAX_CHUNK = std::numeric_limits<uInt>::max();
+    z_stream& zs = inflate_->stream;
+    zs.next_out = reinterpret_cast<Bytef*>(buffer);
+    zs.avail_out = static_cast<uInt>(std::min(capacity, MAX_CHUNK));
+
+    while (zs.avail_out > 0) {
+        if (zs.avail_in == 0 && consumed_ < compressed_.size()) {
+            size_t chunk = std::min(compressed_.size() - consumed_, MAX_CHUNK);
+            zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed_.data() + consumed_));
+            zs.avail_in = static_cast<uInt>(chunk);
+            consumed_ += chunk;
+        }
+
+        int rc = ::inflate(&zs, Z_NO_FLUSH);
+        if (rc == Z_STREAM_END) {
+            finished_ = true;
+            break;
+        }
+        if (rc == Z_BUF_ERROR && zs.avail_in == 0 && consumed_ == compressed_.size()) {
+            corrupt("truncated deflate stream");
+        }
+        if (rc != Z_OK && rc != Z_BUF_ERROR) {
+            corrupt("invalid deflate data");
+        }
+    }
+
+    return static_cast<size_t>(reinterpret_cast<char*>(zs.next_out) - buffer);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "mapped_file.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only access to a ZIP archive (the container of XLSX files).
+// The archive is memory-mapped, entries are located through the central
+// directory (ZIP64 aware) and inflated incrementally, so an entry is never
+// held in memory as a whole.
+class ZipArchive {
+public:
+    explicit ZipArchive(const std::string& filename);
+
+    struct Entry {
+        std::string name;
+        uint16_t method = 0;
+        uint64_t compressedSize = 0;
+        uint64_t uncompressedSize = 0;
+        uint64_t localHeaderOffset = 0;
+    };
+
+    const Entry* find(std::string_view name) const;
+
+    // Sequential reader over the uncompressed bytes of one entry
+    class EntryStream {
+    public:
+        EntryStream(const ZipArchive& archive, const Entry& entry);
+        ~EntryStream();
+
+        EntryStream(const EntryStream&) = delete;
+        EntryStream& operator=(const EntryStream&) = delete;
+
+        // Fills up to `capacity` bytes; returns 0 at end of entry
+        size_t read(char* buffer, size_t capacity);
+
+    private:
+        struct InflateState;
+
+        std::string_view compressed_;
+        uint16_t method_;
+        size_t consumed_ = 0;
+        bool finished_ = false;
+        std::unique_ptr<InflateState> inflate_;
+    };
+
+private:
+    void readCentralDirectory();
+
+    MappedFile file_;
+    std::vector<Entry> entries_;
+};
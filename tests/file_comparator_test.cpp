@@ -1,12 +1,22 @@
 ﻿#include <gtest/gtest.h>
 #include "file_comparator.h"
+#include "fingerprint_sidecar.h"
+#include "block_reader.h"
+#include "bounded_queue.h"
 #include "csv_parser.h"
+#include "csv_tokenizer.h"
 #include "file_type.h"
+#include "row_store.h"
+#include "parallel_ingest.h"
+#include "threaded_comparator.h"
+#include "xlsx_reader.h"
 #include <fstream>
 #include <random>
 #include <filesystem>
 #include <chrono>
+#include <thread>
 #include <xlnt/xlnt.hpp>
+#include <zlib.h>
 
 // ============ TEST HELPER CLASS ============
 
@@ -43,6 +53,66 @@ public:
 
         wb.save(filename);
     }
+
+    // Writes an archive of stored (uncompressed) parts, for hand-written
+    // SpreadsheetML that xlnt would not produce
+    static void createRawFile(
+        const std::string& filename,
+        const std::vector<std::pair<std::string, std::string>>& parts) {
+
+        std::string archive;
+        std::string directory;
+
+        auto put16 = [](std::string& out, uint32_t v) {
+            out += static_cast<char>(v & 0xFF);
+            out += static_cast<char>((v >> 8) & 0xFF);
+        };
+        auto put32 = [&put16](std::string& out, uint32_t v) {
+            put16(out, v & 0xFFFF);
+            put16(out, v >> 16);
+        };
+
+        for (const auto& [name, data] : parts) {
+            uint32_t crc = static_cast<uint32_t>(crc32(0, reinterpret_cast<const Bytef*>(data.data()), static_cast<uInt>(data.size())));
+            uint32_t offset = static_cast<uint32_t>(archive.size());
+            uint32_t size = static_cast<uint32_t>(data.size());
+
+            put32(archive, 0x04034b50);
+            for (uint32_t v : { 20u, 0u, 0u, 0u, 0u }) put16(archive, v);
+            put32(archive, crc);
+            put32(archive, size);
+            put32(archive, size);
+            put16(archive, static_cast<uint32_t>(name.size()));
+            put16(archive, 0);
+            archive += name;
+            archive += data;
+
+            put32(directory, 0x02014b50);
+            for (uint32_t v : { 20u, 20u, 0u, 0u, 0u, 0u }) put16(directory, v);
+            put32(directory, crc);
+            put32(directory, size);
+            put32(directory, size);
+            put16(directory, static_cast<uint32_t>(name.size()));
+            for (uint32_t v : { 0u, 0u, 0u, 0u }) put16(directory, v);
+            put32(directory, 0);
+            put32(directory, offset);
+            directory += name;
+        }
+
+        uint32_t directoryOffset = static_cast<uint32_t>(archive.size());
+        archive += directory;
+        put32(archive, 0x06054b50);
+        put16(archive, 0);
+        put16(archive, 0);
+        put16(archive, static_cast<uint32_t>(parts.size()));
+        put16(archive, static_cast<uint32_t>(parts.size()));
+        put32(archive, static_cast<uint32_t>(directory.size()));
+        put32(archive, directoryOffset);
+        put16(archive, 0);
+
+        std::ofstream file(filename, std::ios::binary);
+        file << archive;
+    }
 };
 
 // ============ TEST FIXTURE ============
@@ -308,6 +378,553 @@ TEST_F(FileComparatorTest, CSV_FilesWithDifferences) {
     std::cout << "Test PASSED: CSV differences detected" << std::endl;
 }
 
+TEST_F(FileComparatorTest, CSV_QuotedFieldsAndLineEndings) {
+    // Same logical content: CRLF vs LF, quoting where it is not required,
+    // escaped quotes and padding around unquoted fields
+    std::ofstream file1(testFile1CSV, std::ios::binary);
+    file1 << "Name,Note,Value\r\n";
+    file1 << "\"Smith, John\",\"said \"\"hi\"\"\",1.5\r\n";
+    file1 << "\r\n";
+    file1 << "Plain,\"  padded  \",2\r\n";
+    file1.close();
+
+    std::ofstream file2(testFile2CSV, std::ios::binary);
+    file2 << "\"Name\",Note,Value\n";
+    file2 << "\"Smith, John\",\"said \"\"hi\"\"\",  1.50  \n";
+    file2 << "  Plain  ,\"  padded  \",2";
+    file2.close();
+
+    FileComparator comparator;
+    auto result = comparator.compare(testFile1CSV, testFile2CSV);
+
+    EXPECT_TRUE(result.filesMatch);
+    EXPECT_EQ(result.file1RowCount, 3);
+    EXPECT_EQ(result.file2RowCount, 3);
+
+    auto fields = CSVParser::parseCSVLine("\"Smith, John\",\"said \"\"hi\"\"\",x\"y\"z");
+    ASSERT_EQ(fields.size(), 3);
+    EXPECT_EQ(fields[0], "Smith, John");
+    EXPECT_EQ(fields[1], "said \"hi\"");
+    EXPECT_EQ(fields[2], "xyz");
+}
+
+TEST_F(FileComparatorTest, CSV_EmbeddedNewlinesInQuotes) {
+    std::ofstream file1(testFile1CSV, std::ios::binary);
+    file1 << "Id,Address\n";
+    file1 << "1,\"12 Main St\nSuite 4\"\n";
+    file1 << "2,\"PO Box, 7\"\n";
+    file1.close();
+
+    std::ofstream file2(testFile2CSV, std::ios::binary);
+    file2 << "2,\"PO Box, 7\"\r\n";
+    file2 << "1,\"12 Main St\nSuite 4\"\r\n";
+    file2 << "Id,Address\r\n";
+    file2.close();
+
+    FileComparator comparator;
+    auto result = comparator.compare(testFile1CSV, testFile2CSV);
+
+    EXPECT_TRUE(result.filesMatch);
+    EXPECT_EQ(result.file1RowCount, 3);
+
+    std::vector<std::vector<std::string>> records;
+    CSVParser::forEachRecord("a,\"x\ny\",b\n\nc,\"q\"\"\"\n",
+        [&records](const std::vector<std::string_view>& fields) {
+            records.emplace_back(fields.begin(), fields.end());
+        });
+    ASSERT_EQ(records.size(), 2);
+    EXPECT_EQ(records[0], (std::vector<std::string>{ "a", "x\ny", "b" }));
+    EXPECT_EQ(records[1], (std::vector<std::string>{ "c", "q\"" }));
+}
+
+TEST_F(FileComparatorTest, CSV_NewlineCountAndEstimate) {
+    std::string data;
+    for (int i = 0; i < 100000; ++i) {
+        data += (i % 7 == 0) ? "row,with,\"quoted\",fields\n" : "r,1\n";
+    }
+    EXPECT_EQ(CSVTokenizer::countNewlines(data), 100000);
+    std::string_view slice = std::string_view(data).substr(3, 9001);
+    EXPECT_EQ(CSVTokenizer::countNewlines(slice),
+        static_cast<size_t>(std::count(slice.begin(), slice.end(), '\n')));
+    EXPECT_EQ(CSVTokenizer::countNewlines(""), 0);
+
+    EXPECT_EQ(CSVTokenizer::estimateRecords("a\nb\nc"), 3);
+    EXPECT_EQ(CSVTokenizer::estimateRecords("a\nb\n"), 2);
+}
+
+TEST_F(FileComparatorTest, CSV_EmptyFiles) {
+    std::ofstream(testFile1CSV).close();
+    std::ofstream(testFile2CSV).close();
+
+    FileComparator comparator;
+    auto result = comparator.compare(testFile1CSV, testFile2CSV);
+
+    EXPECT_TRUE(result.filesMatch);
+    EXPECT_EQ(result.file1RowCount, 0);
+    EXPECT_EQ(result.file2RowCount, 0);
+}
+
+// ============ PARALLEL INGEST TESTS ============
+
+TEST_F(FileComparatorTest, Parallel_ChunkBoundariesAreRecordStarts) {
+    std::string data;
+    for (int i = 0; i < 200; ++i) {
+        data += std::to_string(i) + ",\"multi\nline, \"\"quoted\"\"\nfield\",x\r\n";
+        if (i % 7 == 0) data += "\n";
+    }
+
+    for (size_t chunks : { 1, 2, 3, 5, 8, 64, 1000 }) {
+        std::vector<size_t> boundaries = ParallelCSVIngest::chunkBoundaries(data, chunks);
+        ASSERT_EQ(boundaries.size(), chunks + 1);
+        EXPECT_EQ(boundaries.front(), 0);
+        EXPECT_EQ(boundaries.back(), data.size());
+
+        for (size_t i = 1; i < chunks; ++i) {
+            size_t b = boundaries[i];
+            EXPECT_LE(boundaries[i - 1], b);
+            if (b == data.size()) continue;
+
+            // Starts a record: preceded by a newline with balanced quotes
+            ASSERT_GT(b, 0);
+            EXPECT_EQ(data[b - 1], '\n');
+            EXPECT_EQ(std::count(data.begin(), data.begin() + b, '"') % 2, 0);
+        }
+    }
+}
+
+TEST_F(FileComparatorTest, Parallel_MatchesSequentialIngest) {
+    auto columnsOf = [](const std::vector<Row>& rows) {
+        std::vector<std::vector<std::string>> columns;
+        for (const auto& row : rows) columns.push_back(row.columns);
+        std::sort(columns.begin(), columns.end());
+        return columns;
+    };
+
+    createTestCSVFiles(9);
+
+    // Every row of file 1 appears twice, far apart, so duplicates land in
+    // different chunks and must still collapse
+    {
+        std::ifstream in(testFile1CSV, std::ios::binary);
+        std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        std::ofstream out(testFile1CSV, std::ios::binary | std::ios::app);
+        out << "7,\"quoted\nacross lines\"\n" << content;
+    }
+
+    FileComparator sequential;
+    auto expected = sequential.compare(testFile1CSV, testFile2CSV);
+
+    for (size_t threads : { 2, 3, 8 }) {
+        FileComparator::Options options;
+        options.threads = threads;
+        FileComparator parallel(options);
+        auto actual = parallel.compare(testFile1CSV, testFile2CSV);
+
+        EXPECT_EQ(actual.filesMatch, expected.filesMatch);
+        EXPECT_EQ(actual.file1RowCount, expected.file1RowCount);
+        EXPECT_EQ(actual.file2RowCount, expected.file2RowCount);
+        EXPECT_EQ(columnsOf(actual.onlyInFile1), columnsOf(expected.onlyInFile1));
+        EXPECT_EQ(columnsOf(actual.onlyInFile2), columnsOf(expected.onlyInFile2));
+    }
+
+    EXPECT_EQ(expected.onlyInFile1.size(), 10);
+    EXPECT_EQ(expected.onlyInFile2.size(), 9);
+
+    // Duplicates within and across ranges fold into one row whose count is
+    // every occurrence
+    std::string data;
+    for (int i = 0; i < 3000; ++i) {
+        data += std::to_string(i % 100) + ",\"x\ny\",5" + (i % 2 ? ".0" : "") + "\n";
+    }
+    for (size_t threads : { 2, 5 }) {
+        RowPartitions rows(threads, CellKey::defaults());
+        EXPECT_EQ(ParallelCSVIngest::ingest(data, rows), 3000);
+        EXPECT_EQ(rows.size(), 100);
+        uint64_t occurrences = 0;
+        for (size_t p = 0; p < rows.count(); ++p) {
+            for (RowStore::RowId id : rows[p]) {
+                occurrences += rows[p].count(id);
+            }
+        }
+        EXPECT_EQ(occurrences, 3000);
+
+        // Row-at-a-time inserts route each row to the partition ingest chose
+        RowPartitions inserted(threads, CellKey::defaults());
+        for (int i = 0; i < 3000; ++i) {
+            std::string key = std::to_string(i % 100);
+            inserted.insert({ key, "x\ny", i % 2 ? "5.0" : "5" });
+        }
+        EXPECT_EQ(inserted.size(), 100);
+        for (size_t p = 0; p < rows.count(); ++p) {
+            EXPECT_EQ(inserted[p].size(), rows[p].size());
+            for (RowStore::RowId id : inserted[p]) {
+                EXPECT_NE(rows[p].find(inserted[p].store(), id), RowTable::NOT_FOUND);
+                EXPECT_EQ(inserted[p].count(id), 30);
+            }
+        }
+    }
+}
+
+// ============ THREADED COMPARATOR TESTS ============
+
+TEST_F(FileComparatorTest, Threaded_MatchesFileComparatorAcrossBlocks) {
+    auto columnsOf = [](const std::vector<Row>& rows) {
+        std::vector<std::vector<std::string>> columns;
+        for (const auto& row : rows) columns.push_back(row.columns);
+        std::sort(columns.begin(), columns.end());
+        return columns;
+    };
+
+    // About 4 MiB per file, so the reader cuts several 1 MiB blocks and
+    // quoted newlines land on block boundaries
+    const int rowCount = 40000;
+    std::vector<std::string> rows;
+    for (int i = 0; i < rowCount; ++i) {
+        rows.push_back(std::to_string(i) + ",\"line one\nline " + std::to_string(i % 13) +
+            ", \"\"quoted\"\"\"," + std::to_string(i % 500) + "." + std::to_string(i % 10) +
+            ",padding padding padding padding padding padding padding");
+    }
+
+    {
+        std::ofstream file1(testFile1CSV, std::ios::binary);
+        for (const auto& row : rows) file1 << row << "\n";
+
+        // Reordered, CRLF, and every thousandth row changed
+        std::ofstream file2(testFile2CSV, std::ios::binary);
+        for (int i = rowCount - 1; i >= 0; --i) {
+            file2 << rows[i] << (i % 1000 == 0 ? ",extra" : "") << "\r\n";
+        }
+    }
+
+    auto expected = FileComparator().compare(testFile1CSV, testFile2CSV);
+    auto actual = ThreadedCSVComparator().compare(testFile1CSV, testFile2CSV);
+
+    EXPECT_EQ(actual.filesMatch, expected.filesMatch);
+    EXPECT_EQ(actual.file1RowCount, expected.file1RowCount);
+    EXPECT_EQ(actual.file2RowCount, expected.file2RowCount);
+    EXPECT_EQ(columnsOf(actual.onlyInFile1), columnsOf(expected.onlyInFile1));
+    EXPECT_EQ(columnsOf(actual.onlyInFile2), columnsOf(expected.onlyInFile2));
+
+    EXPECT_EQ(expected.file1RowCount, static_cast<size_t>(rowCount));
+    EXPECT_EQ(expected.onlyInFile1.size(), 40);
+    EXPECT_EQ(expected.onlyInFile2.size(), 40);
+}
+
+TEST_F(FileComparatorTest, Threaded_ShardsCollapseDuplicatesAcrossParsers) {
+    auto columnsOf = [](const std::vector<Row>& rows) {
+        std::vector<std::vector<std::string>> columns;
+        for (const auto& row : rows) columns.push_back(row.columns);
+        std::sort(columns.begin(), columns.end());
+        return columns;
+    };
+
+    // 300 distinct rows, each repeated 200 times across ~2 MiB in spellings
+    // that compare equal, so copies are parsed in different batches and
+    // threads and must still meet in one shard
+    const int distinct = 300;
+    {
+        std::ofstream file1(testFile1CSV, std::ios::binary);
+        for (int copy = 0; copy < 200; ++copy) {
+            for (int i = 0; i < distinct; ++i) {
+                file1 << "row" << i << "," << i << "." << (i % 10) << (copy % 2 ? "00" : "")
+                    << ",\"a\nb\",tail tail tail\n";
+            }
+        }
+
+        std::ofstream file2(testFile2CSV, std::ios::binary);
+        for (int i = 0; i < distinct; ++i) {
+            if (i % 50 == 0) continue;
+            file2 << "row" << i << "," << i << "." << (i % 10) << ",\"a\nb\",tail tail tail\n";
+        }
+        file2 << "row" << distinct << ",0.0,\"a\nb\",tail tail tail\n";
+    }
+
+    auto expected = FileComparator().compare(testFile1CSV, testFile2CSV);
+    auto actual = ThreadedCSVComparator().compare(testFile1CSV, testFile2CSV);
+
+    EXPECT_EQ(actual.file1RowCount, static_cast<size_t>(distinct));
+    EXPECT_EQ(actual.file1RowCount, expected.file1RowCount);
+    EXPECT_EQ(actual.file2RowCount, expected.file2RowCount);
+    EXPECT_EQ(columnsOf(actual.onlyInFile1), columnsOf(expected.onlyInFile1));
+    EXPECT_EQ(columnsOf(actual.onlyInFile2), columnsOf(expected.onlyInFile2));
+    EXPECT_EQ(actual.onlyInFile1.size(), 6);
+    EXPECT_EQ(actual.onlyInFile2.size(), 1);
+
+    // The same rows inserted concurrently straight into the table
+    ShardedRowTable rows;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&rows, t]() {
+            RowStore staging;
+            for (int i = 0; i < 20000; ++i) {
+                std::string id = std::to_string((i * 7 + t) % distinct);
+                std::string value = id + (t % 2 ? ".0" : "");
+                rows.insert({ id, value }, staging);
+                EXPECT_EQ(staging.size(), 0);
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    size_t total = 0;
+    for (size_t shard = 0; shard < ShardedRowTable::SHARDS; ++shard) {
+        total += rows.shard(shard).size();
+    }
+    EXPECT_EQ(total, rows.size());
+    EXPECT_EQ(rows.size(), static_cast<size_t>(distinct));
+}
+
+TEST_F(FileComparatorTest, Threaded_PipelineRecyclesBatchesAndShutsDown) {
+    // Over 20 MiB: more 1 MiB blocks than either input's pool of recycled
+    // batches, so a reader has to wait for parsed batches to come back
+    const int rowCount = 240000;
+    std::string data;
+    data.reserve(static_cast<size_t>(rowCount) * 110);
+    for (int i = 0; i < rowCount; ++i) {
+        data += std::to_string(i) + ",\"multi\nline\"," + std::to_string(i % 1000) +
+            ".25,padding padding padding padding padding padding padding padding\n";
+    }
+    ASSERT_GT(data.size(), size_t(20) << 20);
+    std::ofstream(testFile1CSV, std::ios::binary) << data;
+    std::ofstream(testFile2CSV, std::ios::binary) << data << "extra,\"row\",1,x\n";
+
+    ThreadedCSVComparator comparator;
+    auto result = comparator.compare(testFile1CSV, testFile2CSV);
+    EXPECT_FALSE(result.filesMatch);
+    EXPECT_EQ(result.file1RowCount, static_cast<size_t>(rowCount));
+    EXPECT_EQ(result.file2RowCount, static_cast<size_t>(rowCount) + 1);
+    EXPECT_TRUE(result.onlyInFile1.empty());
+    ASSERT_EQ(result.onlyInFile2.size(), 1);
+    EXPECT_EQ(result.onlyInFile2[0].columns, (std::vector<std::string>{ "extra", "row", "1", "x" }));
+
+    // One reader finishes at once; the other's batches must still drain
+    std::ofstream(testFile2CSV, std::ios::binary).close();
+    result = comparator.compare(testFile1CSV, testFile2CSV);
+    EXPECT_FALSE(result.filesMatch);
+    EXPECT_EQ(result.file1RowCount, static_cast<size_t>(rowCount));
+    EXPECT_EQ(result.file2RowCount, 0);
+    EXPECT_EQ(result.onlyInFile1.size(), static_cast<size_t>(rowCount));
+
+    result = comparator.compare(testFile1CSV, testFile1CSV);
+    EXPECT_TRUE(result.filesMatch);
+    EXPECT_EQ(result.file2RowCount, static_cast<size_t>(rowCount));
+
+    EXPECT_THROW(comparator.compare(testFile1CSV, "missing.csv"), std::runtime_error);
+}
+
+// ============ ROW STORE TESTS ============
+
+TEST_F(FileComparatorTest, RowStore_PacksCellsAndDeduplicates) {
+    RowTable table;
+    std::vector<std::string_view> row1 = { "Alice", "30", "3.14159265" };
+    std::vector<std::string_view> row2 = { "Alice", "30", "3.14159999" };  // equal at 4 dp
+    std::vector<std::string_view> row3 = { "Bob", "", "2.5" };
+
+    EXPECT_TRUE(table.insert(row1));
+    EXPECT_FALSE(table.insert(row2));
+    EXPECT_TRUE(table.insert(row3));
+    EXPECT_EQ(table.size(), 2);
+    EXPECT_EQ(table.store().size(), 2);
+
+    Row materialized = table.store().materialize(1);
+    ASSERT_EQ(materialized.columns.size(), 3);
+    EXPECT_EQ(materialized.columns[0], "Bob");
+    EXPECT_EQ(materialized.columns[1], "");
+    EXPECT_EQ(materialized.columns[2], "2.5");
+
+    // Probe with a row that lives in a different store
+    RowStore other;
+    RowStore::RowId match = other.append({ "Bob", "", "2.50000" });
+    RowStore::RowId miss = other.append({ "Bob", "", "2.5001" });
+    EXPECT_TRUE(table.contains(other, match));
+    EXPECT_FALSE(table.contains(other, miss));
+}
+
+TEST_F(FileComparatorTest, FlatIdSet_GrowsAndProbesAcrossStores) {
+    // No reserve: the table has to grow through several rehashes
+    RowTable table;
+    RowStore probes;
+    for (int i = 0; i < 5000; ++i) {
+        std::string id = std::to_string(i);
+        std::string price = std::to_string(i) + ".25";
+        std::vector<std::string_view> cells = { id, price, "x" };
+        EXPECT_TRUE(table.insert(cells));
+        EXPECT_FALSE(table.insert(cells));
+        probes.append(cells);
+
+        std::string missing = std::to_string(i) + "-missing";
+        cells[0] = missing;
+        probes.append(cells);
+    }
+
+    EXPECT_EQ(table.size(), 5000);
+    for (RowStore::RowId id = 0; id < probes.size(); ++id) {
+        EXPECT_EQ(table.contains(probes, id), id % 2 == 0);
+    }
+
+    // Iteration visits every stored row exactly once
+    std::vector<RowStore::RowId> ids(table.begin(), table.end());
+    std::sort(ids.begin(), ids.end());
+    ASSERT_EQ(ids.size(), 5000);
+    for (size_t i = 0; i < ids.size(); ++i) {
+        EXPECT_EQ(ids[i], i);
+    }
+}
+
+TEST_F(FileComparatorTest, CellKey_CanonicalNumericAndString) {
+    const CellKey::Policy& policy = CellKey::defaults();
+
+    // Numbers are scaled to 4 decimal places
+    EXPECT_EQ(policy.make("3.14159265").kind, CellKey::Kind::Scaled);
+    EXPECT_EQ(policy.make("3.14159265").value, 31416);
+    EXPECT_EQ(policy.make("-0.00001").value, 0);
+    EXPECT_EQ(policy.make("1e3").value, 10000000);
+    EXPECT_EQ(policy.make("1e300").kind, CellKey::Kind::Float);
+
+    // Decimal text scales exactly, halves rounding away from zero where a
+    // double product would land just below them
+    EXPECT_EQ(policy.make("1.00005").value, 10001);
+    EXPECT_EQ(policy.make("-2.00005").value, -20001);
+    EXPECT_EQ(policy.make("0.00004999").value, 0);
+    EXPECT_EQ(policy.make("123456789012.34565").value, 1234567890123457);
+    EXPECT_EQ(policy.make("-922337203685477.5807").value, -9223372036854775807);
+    EXPECT_EQ(policy.make("922337203685477.5808").kind, CellKey::Kind::Float);
+    EXPECT_EQ(policy.make("0.123449999999999999999999").value, 1234);
+    EXPECT_EQ(policy.make("12345678901234.5678901234").value, 123456789012345679);
+    EXPECT_EQ(policy.make("00012345678.90000000").value, 123456789000);
+    EXPECT_EQ(policy.make("+1").value, 10000);
+    EXPECT_EQ(policy.make(".5").value, 5000);
+    EXPECT_EQ(policy.make("5.").value, 50000);
+    EXPECT_EQ(policy.make("5E-5").value, 1);
+    EXPECT_EQ(policy.make("-1.5e+2").value, -1500000);
+    EXPECT_EQ(policy.make("0e999999").value, 0);
+    EXPECT_EQ(policy.make("1e400").kind, CellKey::Kind::String);
+
+    // Everything that is not a finite number keys by its bytes
+    EXPECT_EQ(policy.make("").kind, CellKey::Kind::String);
+    EXPECT_EQ(policy.make("12abc").kind, CellKey::Kind::String);
+    EXPECT_EQ(policy.make("1e").kind, CellKey::Kind::String);
+    EXPECT_EQ(policy.make("-.").kind, CellKey::Kind::String);
+    EXPECT_EQ(policy.make("1.2.3").kind, CellKey::Kind::String);
+    EXPECT_EQ(policy.make("++1").kind, CellKey::Kind::String);
+    EXPECT_EQ(policy.make("nan").kind, CellKey::Kind::String);
+
+    EXPECT_TRUE(Row::compareValues("100", "100.00001"));
+    EXPECT_TRUE(Row::compareValues("-0", "0.0000"));
+    EXPECT_FALSE(Row::compareValues("100", "100.0001"));
+    EXPECT_FALSE(Row::compareValues("abc", "ABC"));
+
+    // Equal rows always hash equally
+    Row row1, row2;
+    row1.columns = { "Fund", "1.00000", "-0.00004" };
+    row2.columns = { "Fund", "1", "0" };
+    EXPECT_TRUE(row1 == row2);
+    EXPECT_EQ(Row::Hash{}(row1), Row::Hash{}(row2));
+
+    RowStore store;
+    RowStore::RowId id = store.append({ "Fund", "1", "0" });
+    EXPECT_EQ(store.hash(id), Row::Hash{}(row1));
+}
+
+TEST_F(FileComparatorTest, ColumnSchema_PacksTypedColumnsLosslessly) {
+    // A header row does not stop a column from being typed
+    std::vector<std::vector<std::string>> sample = { { "Id", "Price", "Date", "Rate", "Name" } };
+    for (int i = 0; i < 50; ++i) {
+        sample.push_back({ std::to_string(i), std::to_string(i) + ".25",
+                           "2025-09-" + std::to_string(10 + i % 20), "0.123456", "n" });
+    }
+    auto schema = std::make_shared<const ColumnSchema>(ColumnSchema::infer(sample));
+    EXPECT_EQ(schema->describe(), "int,dec2,date,float,dict");
+
+    RowTable table(CellKey::defaults(), schema);
+    EXPECT_TRUE(table.insert({ "7", "-12.50", "2024-02-29", "1.5", "x" }));
+    EXPECT_TRUE(table.insert({ "007", "12.5", "2024-02-30", "1.5", "x" }));  // not canonical: kept as text
+    EXPECT_TRUE(table.insert({ "", "", "", "1.5", "y" }));
+    EXPECT_EQ(table.store().packedRows(), 2);
+
+    auto expectRow = [&](RowStore::RowId id, std::vector<std::string> columns) {
+        EXPECT_EQ(table.store().materialize(id).columns, columns);
+    };
+    expectRow(0, { "7", "-12.50", "2024-02-29", "1.5", "x" });
+    expectRow(1, { "007", "12.5", "2024-02-30", "1.5", "x" });
+    expectRow(2, { "", "", "", "1.5", "y" });
+
+    // Packed against packed, and against rows stored as text
+    RowTable other(CellKey::defaults(), schema);
+    other.insert({ "7", "-12.50", "2024-02-29", "1.5", "x" });
+    other.insert({ "7", "-12.51", "2024-02-29", "1.5", "x" });
+    EXPECT_TRUE(table.contains(other.store(), 0));
+    EXPECT_FALSE(table.contains(other.store(), 1));
+
+    RowStore text;
+    RowStore::RowId equal = text.append({ "7.00001", "-12.5", "2024-02-29", "1.50", "x" });
+    RowStore::RowId differs = text.append({ "7", "-12.50", "2024-03-01", "1.5", "x" });
+    EXPECT_TRUE(table.contains(text, equal));
+    EXPECT_FALSE(table.contains(text, differs));
+    EXPECT_FALSE(table.insert({ "7.0", "-12.5", "2024-02-29", "1.5", "x" }));
+    EXPECT_EQ(table.count(0), 2);
+
+    // Dictionary codes follow the comparison policy: with case folded, "x"
+    // and "X" are one class and only the first spelling is coded
+    CellKey::Settings folded;
+    folded.foldCase = true;
+    const CellKey::Policy& foldedPolicy = CellKey::policyFor(folded);
+    std::shared_ptr<StringDictionary> codes;
+    {
+        std::vector<std::vector<std::string>> names;
+        for (int i = 0; i < 20; ++i) names.push_back({ i % 2 ? "USD" : "EUR" });
+        auto dictionary = std::make_shared<const ColumnSchema>(ColumnSchema::infer(names, foldedPolicy));
+        ASSERT_EQ(dictionary->describe(), "dict");
+
+        RowTable currencies(foldedPolicy, dictionary);
+        EXPECT_TRUE(currencies.insert({ "USD" }));
+        EXPECT_FALSE(currencies.insert({ "usd" }));
+        EXPECT_TRUE(currencies.insert({ "EUR" }));
+        EXPECT_EQ(currencies.store().packedRows(), 2);
+        EXPECT_EQ(dictionary->column(0).dictionary->size(), 2);
+
+        RowTable other(foldedPolicy, dictionary);
+        other.insert({ "eur" });  // not the representative: kept as text
+        other.insert({ "GBP" });
+        EXPECT_EQ(other.store().packedRows(), 1);
+        EXPECT_TRUE(currencies.contains(other.store(), 0));
+        EXPECT_FALSE(currencies.contains(other.store(), 1));
+        EXPECT_EQ(other.store().materialize(0).columns[0], "eur");
+        EXPECT_EQ(other.store().materialize(1).columns[0], "GBP");
+        codes = dictionary->column(0).dictionary;
+
+        // Stores must compare under the schema's policy
+        EXPECT_THROW(RowTable(CellKey::defaults(), dictionary), std::runtime_error);
+    }
+
+    // A dictionary keeps the policy it was built under
+    EXPECT_EQ(codes->encode("usd"), StringDictionary::NONE);
+    EXPECT_EQ(codes->encode("GBP"), 2);
+    EXPECT_EQ(codes->encode("Chf"), 3);
+    EXPECT_EQ(codes->encode("CHF"), StringDictionary::NONE);
+
+    // A thread's cache answers like the table, refusals included
+    StringDictionary::Cache cache;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (std::string_view text : { "USD", "usd", "EUR", "Chf", "CHF", "JPY" }) {
+            EXPECT_EQ(cache.encode(*codes, text), codes->encode(text)) << text;
+        }
+    }
+    EXPECT_EQ(codes->size(), 5);
+
+    // Whole comparisons report the same rows either way
+    createTestCSVFiles(5);
+    FileComparator::Options plain;
+    plain.typedColumns = false;
+    auto expected = FileComparator(plain).compare(testFile1CSV, testFile2CSV);
+    auto actual = FileComparator().compare(testFile1CSV, testFile2CSV);
+    EXPECT_EQ(actual.filesMatch, expected.filesMatch);
+    EXPECT_EQ(actual.file1RowCount, expected.file1RowCount);
+    EXPECT_EQ(actual.onlyInFile1.size(), expected.onlyInFile1.size());
+    EXPECT_EQ(actual.onlyInFile2.size(), expected.onlyInFile2.size());
+}
+
 // ============ XLSX COMPARISON TESTS ============
 
 TEST_F(FileComparatorTest, XLSX_IdenticalFilesMatch) {
@@ -452,6 +1069,472 @@ TEST_F(FileComparatorTest, XLSX_MixedTypes) {
     std::cout << "Test PASSED: XLSX mixed types handled" << std::endl;
 }
 
+TEST_F(FileComparatorTest, XLSX_StreamingReaderCellTypes) {
+    // Second sheet is active; its part is only reachable through the rels
+    XLSXTestHelper::createRawFile("test_types.xlsx", {
+        { "_rels/.rels",
+          "<?xml version=\"1.0\"?><Relationships><Relationship Id=\"rId1\" "
+          "Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/officeDocument\" "
+          "Target=\"xl/workbook.xml\"/></Relationships>" },
+        { "xl/workbook.xml",
+          "<?xml version=\"1.0\"?><workbook xmlns:r=\"r\"><bookViews><workbookView activeTab=\"1\"/></bookViews>"
+          "<sheets><sheet name=\"First\" sheetId=\"1\" r:id=\"rId1\"/><sheet name=\"Second\" sheetId=\"2\" r:id=\"rId2\"/></sheets></workbook>" },
+        { "xl/_rels/workbook.xml.rels",
+          "<Relationships><Relationship Id=\"rId1\" Type=\"worksheet\" Target=\"worksheets/sheet1.xml\"/>"
+          "<Relationship Id=\"rId2\" Type=\"worksheet\" Target=\"/xl/worksheets/other.xml\"/>"
+          "<Relationship Id=\"rId3\" Type=\"x/sharedStrings\" Target=\"strings.xml\"/></Relationships>" },
+        { "xl/strings.xml",
+          "<sst uniqueCount=\"2\"><si><t>plain</t></si>"
+          "<si><r><t>Rich</t></r><r><rPr/><t xml:space=\"preserve\"> text</t></r><rPh><t>skip</t></rPh></si></sst>" },
+        { "xl/worksheets/sheet1.xml",
+          "<worksheet><sheetData><row r=\"1\"><c r=\"A1\"><v>0</v></c></row></sheetData></worksheet>" },
+        { "xl/worksheets/other.xml",
+          "<?xml version=\"1.0\"?><worksheet><dimension ref=\"A1:G3\"/><sheetData>"
+          "<row r=\"1\"><c r=\"A1\" t=\"inlineStr\"><is><t>a &amp; b &#x41;</t></is></c>"
+          "<c r=\"B1\" t=\"b\"><v>1</v></c><c r=\"C1\" t=\"str\"><f>A1</f><v>cached</v></c>"
+          "<c r=\"D1\"><v>1.5E-3</v></c><c r=\"E1\" s=\"2\"><v>42</v></c>"
+          "<c r=\"F1\" t=\"s\"><v>1</v></c><c r=\"G1\" s=\"1\"/></row>"
+          "<row r=\"2\"/>"
+          "<row r=\"3\"><c r=\"A3\" t=\"e\"><v>#DIV/0!</v></c><c r=\"B3\" t=\"s\"><v>0</v></c>"
+          "<c r=\"C3\" t=\"b\"><v>0</v></c><c r=\"D3\"><![CDATA[<v>]]><v>-2.5</v></c></row>"
+          "</sheetData></worksheet>" }
+    });
+
+    std::vector<std::vector<std::string>> rows;
+    XLSXReader reader("test_types.xlsx");
+    EXPECT_EQ(reader.estimateRows(), 3);
+    size_t count = reader.forEachRow([&rows](const std::vector<std::string_view>& cells) {
+        rows.emplace_back(cells.begin(), cells.end());
+    });
+
+    ASSERT_EQ(count, 2);
+    EXPECT_EQ(rows[0], (std::vector<std::string>{ "a & b A", "true", "cached", "0.0015", "42", "Rich text", "" }));
+    EXPECT_EQ(rows[1], (std::vector<std::string>{ "#DIV/0!", "plain", "false", "-2.5" }));
+
+    std::filesystem::remove("test_types.xlsx");
+}
+
+// ============ FINGERPRINT ENGINE TESTS ============
+
+TEST_F(FileComparatorTest, Fingerprint_MatchesInMemoryEngine) {
+    auto columnsOf = [](const std::vector<Row>& rows) {
+        std::vector<std::vector<std::string>> columns;
+        for (const auto& row : rows) columns.push_back(row.columns);
+        std::sort(columns.begin(), columns.end());
+        return columns;
+    };
+
+    FileComparator::Options options;
+    options.engine = FileComparator::Engine::Fingerprint;
+
+    createTestCSVFiles(7);
+    createTestXLSXFiles(3);
+
+    for (const auto& [first, second] : { std::pair{ testFile1CSV, testFile2CSV },
+                                         std::pair{ testFile1XLSX, testFile2XLSX } }) {
+        FileComparator inMemory;
+        FileComparator fingerprint(options);
+        auto expected = inMemory.compare(first, second);
+        auto actual = fingerprint.compare(first, second);
+
+        EXPECT_FALSE(actual.filesMatch);
+        EXPECT_EQ(actual.file1RowCount, expected.file1RowCount);
+        EXPECT_EQ(actual.file2RowCount, expected.file2RowCount);
+        EXPECT_EQ(columnsOf(actual.onlyInFile1), columnsOf(expected.onlyInFile1));
+        EXPECT_EQ(columnsOf(actual.onlyInFile2), columnsOf(expected.onlyInFile2));
+    }
+
+    // Re-read by offset must handle quoted newlines and CRLF endings
+    std::ofstream file1(testFile1CSV, std::ios::binary);
+    file1 << "Id,Address\r\n1,\"12 Main St\r\nSuite 4\"\r\n2,\"PO \"\"Box\"\", 7\"\r\n2,\"PO \"\"Box\"\", 7\"\r\n";
+    file1.close();
+
+    std::ofstream file2(testFile2CSV, std::ios::binary);
+    file2 << "Id,Address\n2,\"PO Box, 7\"\n";
+    file2.close();
+
+    FileComparator fingerprint(options);
+    auto result = fingerprint.compare(testFile1CSV, testFile2CSV);
+
+    EXPECT_EQ(result.file1RowCount, 3);
+    EXPECT_EQ(columnsOf(result.onlyInFile1), (std::vector<std::vector<std::string>>{
+        { "1", "12 Main St\r\nSuite 4" }, { "2", "PO \"Box\", 7" } }));
+    EXPECT_EQ(columnsOf(result.onlyInFile2), (std::vector<std::vector<std::string>>{ { "2", "PO Box, 7" } }));
+}
+
+TEST_F(FileComparatorTest, Multiset_ReportsSurplusCopies) {
+    auto columnsOf = [](const std::vector<Row>& rows) {
+        std::vector<std::vector<std::string>> columns;
+        for (const auto& row : rows) columns.push_back(row.columns);
+        std::sort(columns.begin(), columns.end());
+        return columns;
+    };
+
+    std::ofstream file1(testFile1CSV);
+    file1 << "Trade,Qty\nT1,100\nT1,100\nT1,100\nT2,50\nT3,10\n";
+    file1.close();
+
+    std::ofstream file2(testFile2CSV);
+    file2 << "Trade,Qty\nT1,100\nT2,50\nT2,50.00\nT3,10\n";
+    file2.close();
+
+    // As sets the files are equal
+    EXPECT_TRUE(FileComparator().compare(testFile1CSV, testFile2CSV).filesMatch);
+
+    FileComparator::Options options;
+    options.multiset = true;
+    for (auto engine : { FileComparator::Engine::InMemory, FileComparator::Engine::Fingerprint }) {
+        for (size_t threads : { 1, 3 }) {
+            options.engine = engine;
+            options.threads = threads;
+            auto result = FileComparator(options).compare(testFile1CSV, testFile2CSV);
+
+            EXPECT_FALSE(result.filesMatch);
+            EXPECT_EQ(result.file1RowCount, 6);
+            EXPECT_EQ(result.file2RowCount, 5);
+            EXPECT_EQ(columnsOf(result.onlyInFile1), (std::vector<std::vector<std::string>>{
+                { "T1", "100" }, { "T1", "100" } }));
+            // Equal rows are reported as their first occurrence
+            EXPECT_EQ(columnsOf(result.onlyInFile2), (std::vector<std::vector<std::string>>{ { "T2", "50" } }));
+        }
+    }
+}
+
+TEST_F(FileComparatorTest, External_MatchesInMemoryEngine) {
+    auto columnsOf = [](const std::vector<Row>& rows) {
+        std::vector<std::vector<std::string>> columns;
+        for (const auto& row : rows) columns.push_back(row.columns);
+        std::sort(columns.begin(), columns.end());
+        return columns;
+    };
+
+    // Duplicates, so the merge has to group across runs
+    std::ofstream file1(testFile1CSV);
+    std::ofstream file2(testFile2CSV);
+    file1 << "ID,Value\n";
+    file2 << "ID,Value\n";
+    for (int i = 0; i < 20000; ++i) {
+        file1 << i % 15000 << "," << i * 0.5 << "\n";
+        if (i % 7 != 0) file2 << i % 12000 << "," << i * 0.5 << "\n";
+    }
+    file1.close();
+    file2.close();
+
+    FileComparator::Options options;
+    options.engine = FileComparator::Engine::External;
+    // Room for a few thousand entries: many runs, and a fan-in of 2 forces
+    // intermediate merges
+    options.memoryBudget = 64 * 1024;
+
+    for (bool multiset : { false, true }) {
+        for (bool compress : { false, true }) {
+            FileComparator::Options inMemoryOptions;
+            inMemoryOptions.multiset = multiset;
+            options.multiset = multiset;
+            options.compressSpills = compress;
+
+            auto expected = FileComparator(inMemoryOptions).compare(testFile1CSV, testFile2CSV);
+            auto actual = FileComparator(options).compare(testFile1CSV, testFile2CSV);
+
+            EXPECT_FALSE(actual.filesMatch);
+            EXPECT_EQ(actual.file1RowCount, expected.file1RowCount);
+            EXPECT_EQ(actual.file2RowCount, expected.file2RowCount);
+            EXPECT_EQ(columnsOf(actual.onlyInFile1), columnsOf(expected.onlyInFile1));
+            EXPECT_EQ(columnsOf(actual.onlyInFile2), columnsOf(expected.onlyInFile2));
+        }
+    }
+
+    // Spill files do not outlive the comparison
+    options.spillDirectory = "external_spill_test";
+    std::filesystem::create_directory(options.spillDirectory);
+    FileComparator(options).compare(testFile1CSV, testFile2CSV);
+    EXPECT_TRUE(std::filesystem::is_empty(options.spillDirectory));
+    std::filesystem::remove_all(options.spillDirectory);
+}
+
+TEST_F(FileComparatorTest, Partitioned_MatchesInMemoryEngine) {
+    auto columnsOf = [](const std::vector<Row>& rows) {
+        std::vector<std::vector<std::string>> columns;
+        for (const auto& row : rows) columns.push_back(row.columns);
+        std::sort(columns.begin(), columns.end());
+        return columns;
+    };
+
+    std::ofstream file1(testFile1CSV);
+    std::ofstream file2(testFile2CSV);
+    file1 << "ID,Value\n";
+    file2 << "ID,Value\n";
+    for (int i = 0; i < 20000; ++i) {
+        file1 << i % 15000 << "," << i * 0.5 << "\n";
+        if (i % 7 != 0) file2 << i % 12000 << "," << i * 0.5 << "\n";
+    }
+    file1.close();
+    file2.close();
+
+    FileComparator::Options options;
+    options.engine = FileComparator::Engine::Partitioned;
+
+    // Default budget keeps everything in memory; a tiny one spills every
+    // partition several times
+    for (size_t budget : { size_t(1) << 30, size_t(64) * 1024 }) {
+        for (bool multiset : { false, true }) {
+            FileComparator::Options inMemoryOptions;
+            inMemoryOptions.multiset = multiset;
+            options.memoryBudget = budget;
+            options.multiset = multiset;
+            options.compressSpills = multiset;
+            options.threads = multiset ? 3 : 1;
+
+            auto expected = FileComparator(inMemoryOptions).compare(testFile1CSV, testFile2CSV);
+            auto actual = FileComparator(options).compare(testFile1CSV, testFile2CSV);
+
+            EXPECT_FALSE(actual.filesMatch);
+            EXPECT_EQ(actual.file1RowCount, expected.file1RowCount);
+            EXPECT_EQ(actual.file2RowCount, expected.file2RowCount);
+            EXPECT_EQ(columnsOf(actual.onlyInFile1), columnsOf(expected.onlyInFile1));
+            EXPECT_EQ(columnsOf(actual.onlyInFile2), columnsOf(expected.onlyInFile2));
+        }
+    }
+}
+
+TEST_F(FileComparatorTest, Check_DigestsDecideMatchAndFallBackOnDifference) {
+    // Same rows in another order and with equivalent number spellings
+    {
+        std::ofstream file1(testFile1CSV);
+        std::ofstream file2(testFile2CSV);
+        file1 << "ID,Name,Value\n";
+        for (int i = 0; i < 5000; ++i) {
+            file1 << i << ",\"name, " << i << "\"," << i << ".50\n";
+        }
+        for (int i = 4999; i >= 0; --i) {
+            file2 << i << ",\"name, " << i << "\"," << i << ".5\n";
+        }
+        file2 << "ID,Name,Value\n";
+    }
+
+    FileComparator::Options options;
+    options.check = true;
+    options.threads = 3;
+    FileComparator checker(options);
+    auto result = checker.compare(testFile1CSV, testFile2CSV);
+
+    EXPECT_TRUE(result.filesMatch);
+    EXPECT_TRUE(result.matchedByDigest);
+    EXPECT_EQ(result.file1RowCount, 5001);
+    EXPECT_EQ(result.file2RowCount, 5001);
+    std::vector<std::string> names;
+    for (const auto& stage : checker.stats().stages()) names.push_back(stage.name);
+    EXPECT_EQ(names, (std::vector<std::string>{ "digest_file1", "digest_file2" }));
+
+    // A duplicated row changes the digest; the full engine then decides
+    {
+        std::ofstream file2(testFile2CSV, std::ios::app);
+        file2 << "7,\"name, 7\",7.5\n";
+        file2 << "extra,row,1\n";
+    }
+    auto expected = FileComparator().compare(testFile1CSV, testFile2CSV);
+    auto actual = FileComparator(options).compare(testFile1CSV, testFile2CSV);
+
+    EXPECT_FALSE(actual.filesMatch);
+    EXPECT_FALSE(actual.matchedByDigest);
+    EXPECT_EQ(actual.file2RowCount, expected.file2RowCount);
+    ASSERT_EQ(actual.onlyInFile2.size(), 1);
+    EXPECT_EQ(actual.onlyInFile2[0].columns[0], "extra");
+    EXPECT_TRUE(actual.onlyInFile1.empty());
+
+    // Matching digests count every copy of a repeated row; the full engine
+    // counts it once
+    {
+        std::ofstream file1(testFile1CSV, std::ios::app);
+        file1 << "7,\"name, 7\",7.50\n";
+        file1 << "extra,row,1\n";
+    }
+    auto distinct = FileComparator().compare(testFile1CSV, testFile2CSV);
+    auto total = FileComparator(options).compare(testFile1CSV, testFile2CSV);
+
+    EXPECT_TRUE(distinct.filesMatch);
+    EXPECT_FALSE(distinct.matchedByDigest);
+    EXPECT_EQ(distinct.file1RowCount, 5002);
+    EXPECT_TRUE(total.filesMatch);
+    EXPECT_TRUE(total.matchedByDigest);
+    EXPECT_EQ(total.file1RowCount, 5003);
+    EXPECT_EQ(total.file2RowCount, 5003);
+}
+
+TEST_F(FileComparatorTest, Sidecar_ReusedWhileInputUnchanged) {
+    auto columnsOf = [](const std::vector<Row>& rows) {
+        std::vector<std::vector<std::string>> columns;
+        for (const auto& row : rows) columns.push_back(row.columns);
+        std::sort(columns.begin(), columns.end());
+        return columns;
+    };
+
+    createTestCSVFiles(5);
+    std::string sidecar1 = FingerprintSidecar::pathFor(testFile1CSV);
+    std::string sidecar2 = FingerprintSidecar::pathFor(testFile2CSV);
+
+    FileComparator::Options options;
+    options.engine = FileComparator::Engine::Fingerprint;
+    auto expected = FileComparator(options).compare(testFile1CSV, testFile2CSV);
+    EXPECT_FALSE(std::filesystem::exists(sidecar1));
+
+    options.sidecars = true;
+    auto first = FileComparator(options).compare(testFile1CSV, testFile2CSV);
+    ASSERT_TRUE(std::filesystem::exists(sidecar1));
+    ASSERT_TRUE(std::filesystem::exists(sidecar2));
+
+    // Second run maps the sidecars instead of parsing
+    auto loaded = FingerprintSidecar::load(testFile1CSV, CellKey::defaults());
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->rows, expected.file1RowCount);
+    EXPECT_EQ(loaded->index.columns(), 10);
+    auto written = std::filesystem::last_write_time(sidecar1);
+    auto second = FileComparator(options).compare(testFile1CSV, testFile2CSV);
+    EXPECT_EQ(std::filesystem::last_write_time(sidecar1), written);
+
+    for (const auto* result : { &first, &second }) {
+        EXPECT_EQ(result->filesMatch, expected.filesMatch);
+        EXPECT_EQ(result->file1RowCount, expected.file1RowCount);
+        EXPECT_EQ(columnsOf(result->onlyInFile1), columnsOf(expected.onlyInFile1));
+        EXPECT_EQ(columnsOf(result->onlyInFile2), columnsOf(expected.onlyInFile2));
+    }
+
+    // Any change to the input invalidates its sidecar
+    {
+        std::ofstream file1(testFile1CSV, std::ios::app);
+        file1 << "added,row,1\n";
+    }
+    EXPECT_FALSE(FingerprintSidecar::load(testFile1CSV, CellKey::defaults()).has_value());
+    auto third = FileComparator(options).compare(testFile1CSV, testFile2CSV);
+    EXPECT_EQ(third.onlyInFile1.size(), expected.onlyInFile1.size() + 1);
+    EXPECT_TRUE(FingerprintSidecar::load(testFile1CSV, CellKey::defaults()).has_value());
+
+    // Fingerprints of another comparison policy are not reused
+    CellKey::Settings folded;
+    folded.foldCase = true;
+    EXPECT_FALSE(FingerprintSidecar::load(testFile1CSV, CellKey::policyFor(folded)).has_value());
+
+    std::filesystem::remove(sidecar1);
+    std::filesystem::remove(sidecar2);
+}
+
+TEST_F(FileComparatorTest, Incremental_ParsesOnlyAppendedRows) {
+    auto columnsOf = [](const std::vector<Row>& rows) {
+        std::vector<std::vector<std::string>> columns;
+        for (const auto& row : rows) columns.push_back(row.columns);
+        std::sort(columns.begin(), columns.end());
+        return columns;
+    };
+    auto append = [](const std::string& filename, int from, int to) {
+        std::ofstream file(filename, std::ios::app);
+        for (int i = from; i < to; ++i) {
+            file << i << ",\"multi\nline " << i % 50 << "\"," << i * 0.25 << "\n";
+        }
+    };
+
+    append(testFile1CSV, 0, 3000);
+    append(testFile2CSV, 100, 3000);
+
+    FileComparator::Options reference;
+    reference.engine = FileComparator::Engine::Fingerprint;
+    reference.multiset = true;
+    FileComparator::Options options = reference;
+    options.sidecars = true;
+    options.incremental = true;
+
+    FileComparator(options).compare(testFile1CSV, testFile2CSV);
+    auto first = FingerprintSidecar::loadPrefix(testFile1CSV, CellKey::defaults());
+    ASSERT_TRUE(first.has_value());
+    EXPECT_EQ(first->extent, std::filesystem::file_size(testFile1CSV));
+    first.reset();
+
+    // Growing feeds, including a row repeated from the indexed prefix
+    for (int round = 0; round < 3; ++round) {
+        append(testFile1CSV, 3000 + round * 500, 3500 + round * 500);
+        append(testFile2CSV, 3000 + round * 500, 3400 + round * 500);
+        append(testFile2CSV, 1000, 1001);
+
+        FileComparator comparator(options);
+        auto actual = comparator.compare(testFile1CSV, testFile2CSV);
+        auto expected = FileComparator(reference).compare(testFile1CSV, testFile2CSV);
+
+        EXPECT_EQ(actual.file1RowCount, expected.file1RowCount);
+        EXPECT_EQ(actual.file2RowCount, expected.file2RowCount);
+        EXPECT_EQ(columnsOf(actual.onlyInFile1), columnsOf(expected.onlyInFile1));
+        EXPECT_EQ(columnsOf(actual.onlyInFile2), columnsOf(expected.onlyInFile2));
+    }
+
+    auto grown = FingerprintSidecar::loadPrefix(testFile1CSV, CellKey::defaults());
+    ASSERT_TRUE(grown.has_value());
+    EXPECT_EQ(grown->extent, std::filesystem::file_size(testFile1CSV));
+    EXPECT_EQ(grown->rows, 4500);
+    EXPECT_FALSE(FingerprintSidecar::load(testFile1CSV, CellKey::defaults()).has_value());  // never fully hashed
+    grown.reset();
+
+    // Rewriting the end of the indexed extent disqualifies the sidecar
+    {
+        std::fstream file(testFile1CSV, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-3, std::ios::end);
+        file << "9";
+    }
+    EXPECT_FALSE(FingerprintSidecar::loadPrefix(testFile1CSV, CellKey::defaults()).has_value());
+    auto actual = FileComparator(options).compare(testFile1CSV, testFile2CSV);
+    auto expected = FileComparator(reference).compare(testFile1CSV, testFile2CSV);
+    EXPECT_EQ(columnsOf(actual.onlyInFile1), columnsOf(expected.onlyInFile1));
+
+    std::filesystem::remove(FingerprintSidecar::pathFor(testFile1CSV));
+    std::filesystem::remove(FingerprintSidecar::pathFor(testFile2CSV));
+}
+
+TEST_F(FileComparatorTest, Keyed_ReportsAddedRemovedAndChangedCells) {
+    std::ofstream file1(testFile1CSV);
+    file1 << "Desk,TradeId,Price,Qty\n"
+          << "FX,1,1.2500,100\n"
+          << "FX,2,99.5,200\n"
+          << "Rates,2,3.1,50\n"
+          << "Rates,3,7,10\n";
+    file1.close();
+
+    // Reordered; trade 1 only differs within the decimal tolerance
+    std::ofstream file2(testFile2CSV);
+    file2 << "Desk,TradeId,Price,Qty\n"
+          << "Rates,3,7,10\n"
+          << "FX,2,99.75,250\n"
+          << "FX,1,1.25,100\n"
+          << "Credit,4,1,1\n";
+    file2.close();
+
+    FileComparator::Options options;
+    options.keyColumns = { "Desk", "TradeId" };
+    auto result = FileComparator(options).compare(testFile1CSV, testFile2CSV);
+
+    EXPECT_FALSE(result.filesMatch);
+    EXPECT_EQ(result.keyColumns, (std::vector<size_t>{ 0, 1 }));
+    ASSERT_EQ(result.onlyInFile1.size(), 1);
+    EXPECT_EQ(result.onlyInFile1[0].columns, (std::vector<std::string>{ "Rates", "2", "3.1", "50" }));
+    ASSERT_EQ(result.onlyInFile2.size(), 1);
+    EXPECT_EQ(result.onlyInFile2[0].columns, (std::vector<std::string>{ "Credit", "4", "1", "1" }));
+
+    ASSERT_EQ(result.modified.size(), 1);
+    EXPECT_EQ(result.modified[0].file1.columns, (std::vector<std::string>{ "FX", "2", "99.5", "200" }));
+    EXPECT_EQ(result.modified[0].file2.columns, (std::vector<std::string>{ "FX", "2", "99.75", "250" }));
+    EXPECT_EQ(result.modified[0].changedColumns, (std::vector<size_t>{ 2, 3 }));
+
+    // Positions work too, and XLSX re-reads by ordinal
+    options.keyColumns = { "1", "2" };
+    XLSXTestHelper::createTestFile(testFile1XLSX, {
+        { "Desk", "TradeId", "Price", "Qty" }, { "FX", "1", "1.5", "100" }, { "Rates", "3", "7", "10" } });
+    auto xlsx = FileComparator(options).compare(testFile1XLSX, testFile2CSV);
+    EXPECT_TRUE(xlsx.onlyInFile1.empty());
+    EXPECT_EQ(xlsx.onlyInFile2.size(), 2);
+    ASSERT_EQ(xlsx.modified.size(), 1);
+    EXPECT_EQ(xlsx.modified[0].file1.columns, (std::vector<std::string>{ "FX", "1", "1.5", "100" }));
+    EXPECT_EQ(xlsx.modified[0].changedColumns, (std::vector<size_t>{ 2 }));
+
+    options.keyColumns = { "Missing" };
+    EXPECT_THROW(FileComparator(options).compare(testFile1CSV, testFile2CSV), std::runtime_error);
+}
+
 // ============ PERFORMANCE TESTS ============
 
 TEST_F(FileComparatorTest, Performance_CSV_Large) {
@@ -498,8 +1581,195 @@ TEST_F(FileComparatorTest, Performance_XLSX_Large) {
     EXPECT_LT(duration, 60000);  // XLSX is slower, allow more time
 }
 
+TEST_F(FileComparatorTest, Stats_RecordsStagesAndHashTables) {
+    createTestCSVFiles(20);
+
+    FileComparator::Options options;
+    options.threads = 2;
+    FileComparator comparator(options);
+    auto result = comparator.compare(testFile1CSV, testFile2CSV);
+    comparator.writeRowsToCSV("stats_output.csv", result.onlyInFile1);
+    std::filesystem::remove("stats_output.csv");
+
+    const auto& stats = comparator.stats();
+    std::vector<std::string> names;
+    for (const auto& stage : stats.stages()) names.push_back(stage.name);
+    EXPECT_EQ(names, (std::vector<std::string>{ "read_file1", "read_file2", "find_differences", "write_output" }));
+
+    const auto& read1 = stats.stages()[0];
+    EXPECT_EQ(read1.rows, result.file1RowCount);
+    EXPECT_EQ(read1.bytes, std::filesystem::file_size(testFile1CSV));
+    EXPECT_EQ(read1.threads, 2);
+    EXPECT_EQ(stats.stages()[3].rows, result.onlyInFile1.size());
+
+    // One table per partition and side; every row and every probe counted
+    const auto& tables = stats.hashTables();
+    EXPECT_EQ(tables.tables, 4);
+    EXPECT_EQ(tables.entries, result.file1RowCount + result.file2RowCount);
+    EXPECT_LE(tables.entries * 8, tables.slots * 7);
+    EXPECT_GE(tables.groupProbes, tables.lookups);
+
+    std::string json = comparator.stats().toJson();
+    EXPECT_NE(json.find("\"name\": \"find_differences\""), std::string::npos);
+    EXPECT_NE(json.find("\"peak_rss_bytes\": "), std::string::npos);
+    EXPECT_NE(json.find("\"load_factor\": "), std::string::npos);
+}
+
+TEST_F(FileComparatorTest, ChunkReader_CutsOnlyAtRecordBoundaries) {
+    // Quoted newlines and a record longer than a block, spread over many
+    // small blocks; the chunks must hold exactly the records of the file
+    std::string data;
+    for (int i = 0; i < 2000; ++i) {
+        data += std::to_string(i) + ",\"line one\nline " + std::to_string(i) + "\",\"say \"\"hi\"\"\"\n";
+        if (i == 700) data += "long," + std::string(10000, 'x') + "\n";
+    }
+    data += "last,row,no newline";
+    {
+        std::ofstream file("chunks.csv", std::ios::binary);
+        file << data;
+    }
+
+    std::vector<std::vector<std::string>> expected;
+    CSVParser::forEachRecord(data, [&expected](const std::vector<std::string_view>& fields) {
+        expected.emplace_back(fields.begin(), fields.end());
+    });
+
+    CSVChunkReader reader("chunks.csv", 4096, 4);
+    std::vector<std::vector<std::string>> records;
+    std::string joined;
+    std::string chunk;
+    size_t chunks = 0;
+    while (reader.next(chunk)) {
+        joined += chunk;
+        ++chunks;
+        CSVParser::forEachRecord(chunk, [&records](const std::vector<std::string_view>& fields) {
+            records.emplace_back(fields.begin(), fields.end());
+        });
+    }
+    std::filesystem::remove("chunks.csv");
+
+    EXPECT_GT(chunks, 10);
+    EXPECT_EQ(joined, data);
+    EXPECT_EQ(records, expected);
+    EXPECT_EQ(records[1].size(), 3);
+    EXPECT_EQ(records[1][1], "line one\nline 1");
+}
+
+TEST_F(FileComparatorTest, ShardedTable_ConcurrentInsertsKeepDistinctRowsAndCounts) {
+    // Four threads insert overlapping ranges: every row 0..999 is seen by
+    // two threads, each twice
+    ShardedRowTable table;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&table, t]() {
+            RowStore staging;
+            std::vector<std::string> row(2);
+            std::vector<std::string_view> cells(2);
+            for (int pass = 0; pass < 2; ++pass) {
+                for (int i = (t % 2) * 500; i < (t % 2) * 500 + 500; ++i) {
+                    row[0] = std::to_string(i);
+                    row[1] = "value " + std::to_string(i);
+                    cells.assign(row.begin(), row.end());
+                    table.insert(cells, staging);
+                }
+            }
+            EXPECT_EQ(staging.size(), 0);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    EXPECT_EQ(table.size(), 1000);
+    size_t used = 0;
+    for (size_t shard = 0; shard < ShardedRowTable::SHARDS; ++shard) {
+        const RowTable& rows = table.shard(shard);
+        used += rows.size() > 0;
+        for (RowStore::RowId id : rows) {
+            EXPECT_EQ(rows.count(id), 4);
+            EXPECT_EQ(ShardedRowTable::shardOf(rows.store().hash(id)), shard);
+        }
+    }
+    EXPECT_GT(used, ShardedRowTable::SHARDS / 2);
+}
+
+TEST_F(FileComparatorTest, BoundedQueue_BlocksWhenFullAndDrainsAfterClose) {
+    BoundedQueue<int> queue(2);
+    std::atomic<int> pushed{ 0 };
+
+    // The producer stalls on the third item until the consumer makes room
+    std::thread producer([&]() {
+        for (int i = 0; i < 5; ++i) {
+            if (!queue.push(i)) break;
+            ++pushed;
+        }
+        queue.close();
+    });
+
+    std::vector<int> popped;
+    int item = 0;
+    while (queue.pop(item)) {
+        popped.push_back(item);
+    }
+    producer.join();
+
+    EXPECT_EQ(pushed, 5);
+    EXPECT_EQ(popped, (std::vector<int>{ 0, 1, 2, 3, 4 }));
+    EXPECT_FALSE(queue.push(5));
+    EXPECT_FALSE(queue.pop(item));
+}
+
 // ============ ERROR HANDLING TESTS ============
 
+TEST_F(FileComparatorTest, Policy_DecimalsCaseTrimAndNullsAreEachHonoured) {
+    {
+        std::ofstream file1(testFile1CSV);
+        file1 << "1.2341,Alice,\"  x  \",NULL\n";
+        file1 << "7,Bob,y,3\n";
+        std::ofstream file2(testFile2CSV);
+        file2 << "7,Bob,y,3\n";
+        file2 << "1.2338,ALICE,\"x\",\n";
+    }
+
+    CellKey::Settings all;
+    all.decimalPlaces = 3;
+    all.foldCase = true;
+    all.trim = true;
+    all.nullsEqual = true;
+
+    auto compareWith = [&](const CellKey::Settings& settings, FileComparator::Engine engine) {
+        FileComparator::Options options;
+        options.engine = engine;
+        options.comparison = settings;
+        return FileComparator(options).compare(testFile1CSV, testFile2CSV);
+    };
+
+    EXPECT_FALSE(compareWith(CellKey::Settings{}, FileComparator::Engine::InMemory).filesMatch);
+    for (auto engine : { FileComparator::Engine::InMemory, FileComparator::Engine::Fingerprint }) {
+        auto result = compareWith(all, engine);
+        EXPECT_TRUE(result.filesMatch);
+        EXPECT_EQ(result.file1RowCount, 2);
+    }
+
+    // Dropping any one rule brings the difference back
+    for (int rule = 0; rule < 4; ++rule) {
+        CellKey::Settings settings = all;
+        if (rule == 0) settings.decimalPlaces = 4;
+        if (rule == 1) settings.foldCase = false;
+        if (rule == 2) settings.trim = false;
+        if (rule == 3) settings.nullsEqual = false;
+        auto result = compareWith(settings, FileComparator::Engine::InMemory);
+        EXPECT_FALSE(result.filesMatch) << "rule " << rule;
+        EXPECT_EQ(result.onlyInFile1.size(), 1) << "rule " << rule;
+        EXPECT_EQ(result.onlyInFile2.size(), 1) << "rule " << rule;
+    }
+
+    CellKey::Settings unsupported;
+    unsupported.decimalPlaces = CellKey::MAX_DECIMAL_PLACES + 1;
+    EXPECT_THROW(CellKey::policyFor(unsupported), std::runtime_error);
+    FileComparator::Options invalid;
+    invalid.comparison = unsupported;
+    EXPECT_THROW(FileComparator{ invalid }, std::runtime_error);
+}
+
 TEST_F(FileComparatorTest, Error_FileNotFound) {
     FileComparator comparator;
 